@@ -0,0 +1,229 @@
+#ifndef __ALLOCATOR_H__
+#define __ALLOCATOR_H__
+
+#include <cassert>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <type_traits>
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+// Slot of a NodePool: a node or a link of the free list. Slots of nodes
+// with a destructor also say whether a node lives there, so that Clear
+// finds them in one sweep
+template <class Node, bool Tracked>
+struct PoolSlot {
+	union {
+		PoolSlot *next;
+		typename std::aligned_storage<sizeof(Node), alignof(Node)>::type storage;
+	};
+	bool live;
+	void Mark(bool l) { live = l; }
+	bool Live() const { return live; }
+};
+
+template <class Node>
+struct PoolSlot<Node, false> {
+	union {
+		PoolSlot *next;
+		typename std::aligned_storage<sizeof(Node), alignof(Node)>::type storage;
+	};
+	void Mark(bool l) {}
+	bool Live() const { return false; }
+};
+
+// Slab allocator for tree nodes.
+// Nodes are carved out of large slabs and recycled through an intrusive
+// free list, so creating and dropping nodes never reaches malloc once the
+// pool is warm. The owner does not need to remember its nodes: destroying
+// the pool releases every slab at once.
+template <class Node, bool HugePage = false>
+class NodePool {
+	typedef PoolSlot<Node, !std::is_trivially_destructible<Node>::value> Slot;
+
+	struct Slab {
+		Slot *begin;
+		size_t count;
+		size_t bytes;
+	};
+
+public:
+	// 2MB matches the transparent huge page size on x86-64
+	static const size_t SLAB_BYTES = HugePage ? (2u << 20) : (64u << 10);
+
+	NodePool() : free_list(nullptr), cursor(nullptr), last(nullptr), live(0) {}
+	NodePool(const NodePool &) = delete;
+	NodePool &operator=(const NodePool &) = delete;
+	NodePool(NodePool &&o) : NodePool() { Swap(o); }
+	NodePool &operator=(NodePool &&o) {
+		if (this != &o) Clear(), Swap(o);
+		return *this;
+	}
+	~NodePool() { Clear(); }
+
+	template <class... Args>
+	Node *Create(Args&&... args) {
+		Slot *slot = free_list;
+		if (slot) free_list = slot->next;
+		else {
+			if (cursor == last) Grow();
+			slot = cursor++;
+		}
+		++live;
+		Node *node = new (&slot->storage) Node(std::forward<Args>(args)...);
+		slot->Mark(true);
+		return node;
+	}
+
+	void Destroy(Node *node) {
+		assert(live > 0);
+		node->~Node();
+		Slot *slot = reinterpret_cast<Slot *>(node);
+		slot->Mark(false);
+		slot->next = free_list;
+		free_list = slot;
+		--live;
+	}
+
+	// Release every node at once.
+	// O(#slabs) when Node is trivially destructible, one sweep over the
+	// slots otherwise
+	void Clear() {
+		DestroyLive(typename std::is_trivially_destructible<Node>::type());
+		for (size_t i = 0 ; i < slabs.size() ; ++i) Release(slabs[i]);
+		slabs.clear();
+		free_list = cursor = last = nullptr;
+		live = 0;
+	}
+
+	// Make room for n more nodes without touching the allocator again
+	void Reserve(size_t n) {
+		size_t avail = last - cursor;
+		if (n > avail) Grow(n - avail);
+	}
+
+	size_t Size() const { return live; }
+
+	size_t Bytes() const {
+		size_t bytes = 0;
+		for (size_t i = 0 ; i < slabs.size() ; ++i) bytes += slabs[i].bytes;
+		return bytes;
+	}
+
+	void Swap(NodePool &o) {
+		std::swap(free_list, o.free_list);
+		std::swap(cursor, o.cursor);
+		std::swap(last, o.last);
+		std::swap(live, o.live);
+		slabs.swap(o.slabs);
+	}
+
+	// Take over the slabs and nodes of o, which is left empty.
+	// Nodes do not move, so pointers into o stay valid.
+	// O(#slabs + free slots of o)
+	void Adopt(NodePool &o) {
+		if (&o == this || o.slabs.empty()) return;
+		if (slabs.empty()) return Swap(o);
+		o.Retire();
+		if (o.free_list) {
+			Slot *tail = o.free_list;
+			while (tail->next) tail = tail->next;
+			tail->next = free_list;
+			free_list = o.free_list;
+		}
+		// Our newest slab stays last, it is the one the cursor is in
+		slabs.insert(slabs.begin(), o.slabs.begin(), o.slabs.end());
+		live += o.live;
+		o.slabs.clear();
+		o.free_list = o.cursor = o.last = nullptr;
+		o.live = 0;
+	}
+
+private:
+	// Hand the tail of the current slab to the free list so that
+	// every slot outside the newest slab is either live or free
+	void Retire() {
+		while (cursor != last) {
+			cursor->Mark(false);
+			cursor->next = free_list;
+			free_list = cursor++;
+		}
+	}
+
+	void Grow(size_t min_count = 1) {
+		Retire();
+		size_t count = std::max(min_count, std::max<size_t>(1, SLAB_BYTES / sizeof(Slot)));
+		Slab slab = Acquire(count);
+		slabs.push_back(slab);
+		cursor = slab.begin;
+		last = slab.begin + slab.count;
+	}
+
+	static Slab Acquire(size_t count) {
+		Slab slab;
+		slab.bytes = count * sizeof(Slot);
+#ifdef __linux__
+		if (HugePage) {
+			slab.bytes = (slab.bytes + SLAB_BYTES - 1) / SLAB_BYTES * SLAB_BYTES;
+			void *mem = mmap(nullptr, slab.bytes, PROT_READ | PROT_WRITE,
+					MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			if (mem == MAP_FAILED) throw std::bad_alloc();
+#ifdef MADV_HUGEPAGE
+			madvise(mem, slab.bytes, MADV_HUGEPAGE);
+#endif
+			slab.begin = static_cast<Slot *>(mem);
+			slab.count = slab.bytes / sizeof(Slot);
+			return slab;
+		}
+#endif
+		slab.begin = static_cast<Slot *>(::operator new(slab.bytes));
+		slab.count = count;
+		return slab;
+	}
+
+	static void Release(const Slab &slab) {
+#ifdef __linux__
+		if (HugePage) { munmap(slab.begin, slab.bytes); return; }
+#endif
+		::operator delete(slab.begin);
+	}
+
+	void DestroyLive(std::true_type) {}
+
+	// Every slot before the cursor has been handed out or retired, and
+	// says whether it holds a node. The ones past it were never touched
+	void DestroyLive(std::false_type) {
+		if (!live) return;
+		for (size_t i = 0 ; i < slabs.size() ; ++i) {
+			Slot *end = (i + 1 == slabs.size())?cursor:slabs[i].begin + slabs[i].count;
+			for (Slot *s = slabs[i].begin ; s != end ; ++s)
+				if (s->Live()) reinterpret_cast<Node *>(&s->storage)->~Node();
+		}
+	}
+
+	Slot *free_list;
+	Slot *cursor, *last;
+	size_t live;
+	std::vector<Slab> slabs;
+};
+
+// Allocator policies shared by SplayTree, LinkCutTree and EulerTree.
+// A policy only names the pool used for each node type of the structure.
+struct PoolAllocator {
+	template <class Node>
+	using Pool = NodePool<Node, false>;
+};
+
+// Same as PoolAllocator but slabs are 2MB mappings advised for
+// transparent huge pages (falls back to PoolAllocator off Linux)
+struct HugePagePoolAllocator {
+	template <class Node>
+	using Pool = NodePool<Node, true>;
+};
+
+#endif /* __ALLOCATOR_H__ */
@@ -0,0 +1,106 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdlib>
+
+#include "allocator.h"
+#include "statistics.h"
+#include "splay_tree.h"
+#include "link_cut_tree.h"
+#include "euler_tree.h"
+
+using namespace std;
+
+struct Counted {
+	static size_t alive;
+	std::string payload;
+	Counted(int x) : payload(std::to_string(x)) { ++alive; }
+	~Counted() { --alive; }
+};
+size_t Counted::alive = 0;
+
+void node_pool_test(size_t N) {
+	NodePool<size_t> pool;
+	vector<size_t *> nodes;
+	for (size_t i = 0 ; i < N ; ++i) nodes.push_back(pool.Create(i));
+	assert(pool.Size() == N);
+	for (size_t i = 0 ; i < N ; ++i) assert(*nodes[i] == i);
+
+	// Freed slots are handed out again before the pool grows
+	size_t bytes = pool.Bytes();
+	for (size_t i = 0 ; i < N ; i += 2) pool.Destroy(nodes[i]);
+	for (size_t i = 0 ; i < N ; i += 2) nodes[i] = pool.Create(i);
+	assert(pool.Bytes() == bytes);
+	for (size_t i = 0 ; i < N ; ++i) assert(*nodes[i] == i);
+
+	pool.Clear();
+	assert(pool.Size() == 0 && pool.Bytes() == 0);
+
+	// Live nodes with a destructor are still destroyed on teardown
+	{
+		NodePool<Counted> counted;
+		vector<Counted *> cs;
+		for (size_t i = 0 ; i < N ; ++i) cs.push_back(counted.Create(i));
+		counted.Reserve(N);
+		for (size_t i = 0 ; i < N ; i += 3) counted.Destroy(cs[i]);
+		assert(Counted::alive == N - (N + 2) / 3);
+	}
+	assert(Counted::alive == 0);
+
+	// Adopted nodes stay put, free slots of both are reused
+	{
+		NodePool<Counted> a, b;
+		vector<Counted *> cs;
+		for (size_t i = 0 ; i < N ; ++i) cs.push_back((i % 2?a:b).Create(i));
+		for (size_t i = 0 ; i < N ; i += 4) b.Destroy(cs[i]);
+		size_t bytes = a.Bytes() + b.Bytes(), live = a.Size() + b.Size();
+		a.Adopt(b);
+		assert(b.Size() == 0 && b.Bytes() == 0);
+		assert(a.Size() == live && a.Bytes() == bytes && Counted::alive == live);
+		for (size_t i = 1 ; i < N ; i += 2) assert(cs[i]->payload == to_string(i));
+		for (size_t i = 0 ; i < N ; i += 4) a.Create(i);
+		assert(a.Bytes() == bytes);
+		b.Create(0);
+	}
+	assert(Counted::alive == 0);
+
+	NodePool<size_t, true> huge;
+	for (size_t i = 0 ; i < N ; ++i) assert(*huge.Create(i) == i);
+	assert(huge.Bytes() % (2u << 20) == 0);
+
+	std::cout << "Node pool test Done" << std::endl;
+}
+
+void huge_page_structures_test(size_t N) {
+	SplayTree<int, SubtreeSizeStatistic, SplayNode<int, SubtreeSizeStatistic>,
+		std::less<int>, HugePagePoolAllocator> st;
+	for (size_t i = 0 ; i < N ; ++i) st.Insert(i);
+	for (size_t i = 0 ; i < N ; i += 2) st.Erase(i);
+	assert(st.StatisticComp(N).ss == N / 2);
+
+	typedef LinkCutTree<size_t, SumStatistic<size_t>, true, HugePagePoolAllocator> LCT;
+	LCT lct;
+	vector<LCT::Node *> lnodes;
+	for (size_t i = 0 ; i < N ; ++i) lnodes.push_back(lct.Add(1));
+	for (size_t i = 1 ; i < N ; ++i) lct.Link(lnodes[i], lnodes[i-1]);
+	assert(lct.Path(lnodes[N-1]).sum == N);
+	lct.Cut(lnodes[N-1]);
+	lct.Remove(lnodes[N-1]);
+	assert(lct.Size() == N - 1);
+
+	typedef EulerTree<size_t, true, Statistic, HugePagePoolAllocator> ET;
+	ET et;
+	vector<ET::Node *> enodes;
+	for (size_t i = 0 ; i < N ; ++i) enodes.push_back(et.Add(i));
+	for (size_t i = 1 ; i < N ; ++i) et.Link(enodes[i], enodes[(i-1)/2]);
+	for (size_t i = 0 ; i < N ; ++i) assert(et.FindRoot(enodes[i]) == enodes[0]);
+
+	std::cout << "Huge page structures test Done" << std::endl;
+}
+
+int main(int argc, const char *argv[])
+{
+	node_pool_test(100000);
+	huge_page_structures_test(1000);
+	return 0;
+}
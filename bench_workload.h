@@ -0,0 +1,203 @@
+#ifndef __BENCH_WORKLOAD_H__
+#define __BENCH_WORKLOAD_H__
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <cstdlib>
+#include <chrono>
+#include <algorithm>
+
+// Workloads shared by the benchmarks: tree shapes, operation streams
+// checked against a naive parent-array forest, and latency percentiles.
+
+static const size_t NO_VERTEX = (size_t)-1;
+
+enum Shape { PATH, STAR, CATERPILLAR, RANDOM_TREE, BINARY };
+
+inline const char *ShapeName(Shape shape) {
+	static const char *names[] = { "path", "star", "caterpillar", "random", "binary" };
+	return names[shape];
+}
+
+// Parent array of a tree on n vertices rooted at 0
+inline std::vector<size_t> MakeShape(Shape shape, size_t n) {
+	std::vector<size_t> par(n, NO_VERTEX);
+	for (size_t i = 1 ; i < n ; ++i) {
+		switch (shape) {
+			case PATH: par[i] = i - 1; break;
+			case STAR: par[i] = 0; break;
+			// Spine of n / 2 vertices with legs hanging off it
+			case CATERPILLAR: par[i] = i < n / 2?i - 1:rand() % (n / 2); break;
+			case RANDOM_TREE: par[i] = rand() % i; break;
+			case BINARY: par[i] = (i - 1) / 2; break;
+		}
+	}
+	return par;
+}
+
+// The baseline: every vertex knows its parent and nothing else.
+// Root, path and LCA queries walk up, Evert reverses the root path.
+class NaiveForest {
+public:
+	NaiveForest(const std::vector<size_t> &parents) : par(parents) {}
+
+	size_t FindRoot(size_t v) const {
+		while (par[v] != NO_VERTEX) v = par[v];
+		return v;
+	}
+
+	// Sum of the vertex ids from the root down to v
+	size_t Path(size_t v) const {
+		size_t sum = 0;
+		for (; v != NO_VERTEX ; v = par[v]) sum += v;
+		return sum;
+	}
+
+	size_t FindLCA(size_t v, size_t w) const {
+		size_t dv = Depth(v), dw = Depth(w);
+		for (; dv > dw ; --dv) v = par[v];
+		for (; dw > dv ; --dw) w = par[w];
+		while (v != w) {
+			v = par[v], w = par[w];
+			if (v == NO_VERTEX || w == NO_VERTEX) return NO_VERTEX;
+		}
+		return v;
+	}
+
+	size_t Parent(size_t v) const {
+		return par[v];
+	}
+
+	void Cut(size_t v) {
+		par[v] = NO_VERTEX;
+	}
+
+	// v is a root
+	void Link(size_t v, size_t w) {
+		par[v] = w;
+	}
+
+	void Relink(size_t v, size_t w) {
+		par[v] = w;
+	}
+
+	void Evert(size_t v) {
+		for (size_t prev = NO_VERTEX ; v != NO_VERTEX ;) {
+			size_t next = par[v];
+			par[v] = prev;
+			prev = v, v = next;
+		}
+	}
+
+	size_t Depth(size_t v) const {
+		size_t d = 0;
+		for (; par[v] != NO_VERTEX ; v = par[v]) ++d;
+		return d;
+	}
+
+private:
+	std::vector<size_t> par;
+};
+
+struct Op {
+	enum Type { FIND_ROOT, PATH, FIND_LCA, RELINK, EVERT, TYPES };
+	Type type;
+	size_t v, w; // RELINK cuts v from its parent and links it below w
+	Op(Type type, size_t v, size_t w = 0) : type(type), v(v), w(w) {}
+};
+
+inline const char *OpName(Op::Type type) {
+	static const char *names[] = { "FindRoot", "Path", "FindLCA", "Cut+Link", "Evert" };
+	return names[type];
+}
+
+// ops random operations of the given types on the tree par. Relinks are
+// kept valid by replaying the stream on a naive forest.
+// adversarial_evert everts the two ends of the tree in turn instead of
+// random vertices, so every evert flips a whole root path.
+inline std::vector<Op> MakeStream(const std::vector<size_t> &par, size_t ops,
+		const std::vector<Op::Type> &types, bool adversarial_evert = false) {
+	size_t n = par.size();
+	NaiveForest forest(par);
+	std::vector<Op> stream;
+	size_t everts = 0;
+	for (size_t k = 0 ; k < ops ; ++k) {
+		Op::Type type = types[rand() % types.size()];
+		size_t v = rand() % n, w = rand() % n;
+		if (type == Op::RELINK) {
+			size_t p = forest.Parent(v);
+			if (p == NO_VERTEX) continue;
+			forest.Cut(v);
+			if (forest.FindRoot(w) == v) w = p;
+			forest.Link(v, w);
+		} else if (type == Op::EVERT) {
+			if (adversarial_evert) v = everts++ % 2?n - 1:0;
+			forest.Evert(v);
+		}
+		stream.push_back(Op(type, v, w));
+	}
+	return stream;
+}
+
+// Latency samples of one kind of operation
+class Latency {
+public:
+	Latency() : total(0) {}
+
+	void Add(double ns) {
+		samples.push_back(ns);
+		total += ns;
+	}
+
+	size_t Count() const {
+		return samples.size();
+	}
+
+	double OpsPerSec() const {
+		return total > 0?samples.size() / total * 1e9:0;
+	}
+
+	double Percentile(double p) {
+		if (samples.empty()) return 0;
+		size_t k = std::min(samples.size() - 1, size_t(p * samples.size()));
+		std::nth_element(samples.begin(), samples.begin() + k, samples.end());
+		return samples[k];
+	}
+
+private:
+	std::vector<double> samples;
+	double total;
+};
+
+// Runs the stream on a forest adapter and prints one line per kind of
+// operation. Answers are folded into a checksum to compare forests.
+template <class Forest>
+size_t RunStream(const char *name, Forest &forest, const std::vector<Op> &stream) {
+	typedef std::chrono::steady_clock Clock;
+	std::vector<Latency> latency(Op::TYPES);
+	size_t check = 0;
+	for (size_t i = 0 ; i < stream.size() ; ++i) {
+		const Op &op = stream[i];
+		Clock::time_point t0 = Clock::now();
+		switch (op.type) {
+			case Op::FIND_ROOT: check = check * 31 + forest.FindRoot(op.v); break;
+			case Op::PATH: check = check * 31 + forest.Path(op.v); break;
+			case Op::FIND_LCA: check = check * 31 + forest.FindLCA(op.v, op.w); break;
+			case Op::RELINK: forest.Relink(op.v, op.w); break;
+			case Op::EVERT: forest.Evert(op.v); break;
+			default: break;
+		}
+		latency[op.type].Add(std::chrono::duration<double, std::nano>(Clock::now() - t0).count());
+	}
+	for (size_t t = 0 ; t < Op::TYPES ; ++t) {
+		if (!latency[t].Count()) continue;
+		std::cout << "  " << std::left << std::setw(22) << name << std::setw(10) << OpName(Op::Type(t))
+			<< std::right << std::setw(12) << size_t(latency[t].OpsPerSec()) << " ops/s"
+			<< std::setw(10) << size_t(latency[t].Percentile(0.5)) << " ns p50"
+			<< std::setw(10) << size_t(latency[t].Percentile(0.99)) << " ns p99" << std::endl;
+	}
+	return check;
+}
+
+#endif /* __BENCH_WORKLOAD_H__ */
@@ -0,0 +1,236 @@
+#ifndef __COMPACT_LINK_CUT_TREE_H__
+#define __COMPACT_LINK_CUT_TREE_H__
+
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+#include "statistics.h"
+#include "link_cut_access.h"
+
+// Link cut tree with a compact node layout for very large forests.
+// Vertices are 32-bit indices into contiguous arrays instead of pointers.
+// The splay links (hot, touched by every rotation) live apart from the
+// key and statistic (cold, touched only when a node is recomputed),
+// and the reverse flag takes the top bit of the parent index.
+// The operations are those of LinkCutTree (LinkCutAccess), only the
+// layout differs. A statistic built on EmptyStatistic, e.g.
+// SumStatistic<T, EmptyStatistic>, keeps the cold arrays smallest.
+//
+// Usage Note.
+// To use Remove(), coder make sure that there is no connection to the vertex
+template <class T, class Stat, bool Evertable = false>
+class CompactLinkCutTree {
+public:
+	typedef T ItemType;
+	typedef uint32_t Node;
+	static const Node NIL = 0x7fffffffu;
+
+	struct Links {
+		uint32_t p; // parent or path parent, top bit is the reverse flag
+		Node l, r;
+	};
+
+	struct Data {
+		T key;
+		Stat stat;
+	};
+
+	CompactLinkCutTree() : size(0), free_list(NIL) {}
+	CompactLinkCutTree(const CompactLinkCutTree &) = delete;
+
+	void Reserve(size_t n) {
+		links.reserve(n);
+		data.reserve(n);
+	}
+
+	Node Add(const T& value) {
+		Node v;
+		if (free_list != NIL) {
+			v = free_list;
+			free_list = links[v].l;
+		} else {
+			v = links.size();
+			assert(v < NIL);
+			links.push_back(Links());
+			data.push_back(Data());
+		}
+		links[v].p = NIL, links[v].l = links[v].r = NIL;
+		data[v].key = value;
+		data[v].stat = Stat();
+		data[v].stat.Add();
+		Update(v);
+		++size;
+		return v;
+	}
+
+	void Remove(Node v) {
+		Cut(v);
+		--size;
+		links[v].l = free_list;
+		free_list = v;
+	}
+
+	Node Access(Node v) {
+		return Ops::Access(*this, v);
+	}
+
+	Node FindRoot(Node v) {
+		return Ops::FindRoot(*this, v);
+	}
+
+	void Cut(Node v) {
+		Ops::Cut(*this, v);
+	}
+
+	// w becomes the parent of v
+	void Link(Node v, Node w) {
+		Ops::Link(*this, v, w);
+	}
+
+	Node FindLCA(Node v, Node w) {
+		return Ops::FindLCA(*this, v, w);
+	}
+
+	void Evert(Node v) {
+		Ops::Evert(*this, v);
+	}
+
+	Stat Path(Node v) {
+		Access(v);
+		return data[v].stat;
+	}
+
+	Node Parent(Node v) {
+		return Ops::Parent(*this, v);
+	}
+
+	bool IsRoot(Node v) {
+		return Ops::IsRoot(*this, v);
+	}
+
+	const T& Key(Node v) const {
+		return data[v].key;
+	}
+
+	size_t Size() const {
+		return size;
+	}
+
+	// Bytes held per vertex slot
+	static size_t NodeBytes() {
+		return sizeof(Links) + sizeof(Data);
+	}
+
+private:
+	typedef LinkCutAccess<CompactLinkCutTree, Node, Evertable> Ops;
+	friend struct LinkCutAccess<CompactLinkCutTree, Node, Evertable>;
+
+	static const uint32_t REVERSE = 0x80000000u;
+
+	// Layout for Ops (see LinkCutAccess)
+	static Node Nil() { return NIL; }
+	Node Left(Node x) const { return links[x].l; }
+	Node Right(Node x) const { return links[x].r; }
+	Node Up(Node x) const { return P(x); }
+
+	Node &L(Node x) { return links[x].l; }
+	Node &R(Node x) { return links[x].r; }
+	Node P(Node x) const { return links[x].p & ~REVERSE; }
+	void SetParent(Node x, Node p) { links[x].p = (links[x].p & REVERSE) | p; }
+	bool Reversed(Node x) const { return links[x].p & REVERSE; }
+	void Flip(Node x) { links[x].p ^= REVERSE; }
+
+	bool IsSplayRoot(Node x) const {
+		Node p = P(x);
+		return p == NIL || (links[p].l != x && links[p].r != x);
+	}
+
+	void Update(Node x) {
+		Data &d = data[x];
+		d.stat.Init(d.key);
+		if (links[x].l != NIL) d.stat.UpdateLeft(data[links[x].l].stat);
+		if (links[x].r != NIL) d.stat.UpdateRight(data[links[x].r].stat);
+	}
+
+	size_t SwitchPreferred(Node w, Node v) {
+		if (R(w) == NIL && v == NIL) return 0;
+		R(w) = v;
+		Update(w);
+		return 1;
+	}
+
+	void DetachLeft(Node v) {
+		Node w = L(v);
+		L(v) = NIL;
+		SetParent(w, NIL);
+		Update(v);
+	}
+
+	void AttachLeft(Node v, Node w) {
+		L(v) = w;
+		SetParent(w, v);
+		Update(v);
+	}
+
+	// Statistic should be commutative if evertable (see LinkCutTree)
+	void PushReverse(Node x) {
+		if (!Evertable || !Reversed(x)) return;
+		Links &lx = links[x];
+		std::swap(lx.l, lx.r);
+		if (lx.l != NIL) Flip(lx.l);
+		if (lx.r != NIL) Flip(lx.r);
+		Flip(x);
+	}
+
+	// Rotate x above its parent, only the parent is recomputed
+	void Rotate(Node x) {
+		Node y = P(x), z = P(y);
+		if (!IsSplayRoot(y)) (L(z) == y)?(L(z) = x):(R(z) = x);
+		SetParent(x, z);
+		if (L(y) == x) {
+			L(y) = R(x);
+			if (L(y) != NIL) SetParent(L(y), y);
+			R(x) = y;
+		} else {
+			R(y) = L(x);
+			if (R(y) != NIL) SetParent(R(y), y);
+			L(x) = y;
+		}
+		SetParent(y, x);
+		Update(y);
+	}
+
+	void Splay(Node x) {
+		if (Evertable) {
+			// Resolve reverse flags from the splay root down to x
+			path.clear();
+			for (Node y = x ; ; y = P(y)) {
+				path.push_back(y);
+				if (IsSplayRoot(y)) break;
+			}
+			for (size_t i = path.size() ; i --> 0 ;) PushReverse(path[i]);
+		}
+		if (IsSplayRoot(x)) return;
+		while (!IsSplayRoot(x)) {
+			Node y = P(x);
+			if (!IsSplayRoot(y)) {
+				Node z = P(y);
+				((L(z) == y) == (L(y) == x))?Rotate(y):Rotate(x);
+			}
+			Rotate(x);
+		}
+		Update(x);
+	}
+
+	size_t size;
+	Node free_list;
+	std::vector<Links> links;
+	std::vector<Data> data;
+	std::vector<Node> path;
+};
+
+template <class T, class Stat, bool Evertable>
+const typename CompactLinkCutTree<T, Stat, Evertable>::Node CompactLinkCutTree<T, Stat, Evertable>::NIL;
+
+#endif /* __COMPACT_LINK_CUT_TREE_H__ */
@@ -0,0 +1,111 @@
+#include <iostream>
+#include <vector>
+#include <cstdlib>
+#include <limits>
+
+#include "statistics.h"
+#include "link_cut_tree.h"
+#include "compact_link_cut_tree.h"
+
+using namespace std;
+
+typedef SumStatistic<size_t, EmptyStatistic> Sum;
+
+template <bool Evertable>
+void compact_link_cut_tree_test(size_t N) {
+	typedef LinkCutTree<size_t, SumStatistic<size_t>, Evertable> LCT;
+	typedef CompactLinkCutTree<size_t, Sum, Evertable> CLCT;
+	typedef typename CLCT::Node CNode;
+	LCT lct;
+	CLCT clct;
+	clct.Reserve(N);
+	vector<typename LCT::Node *> node;
+	vector<CNode> cnode;
+
+	for (size_t i = 0; i < N; ++i) {
+		size_t w = rand() % N + 1;
+		node.push_back(lct.Add(w));
+		cnode.push_back(clct.Add(w));
+		assert(clct.Key(cnode[i]) == w);
+	}
+
+	// Random forest with a few roots
+	for (size_t i = 1; i < N; ++i) {
+		if (rand() % 100 == 0) continue;
+		size_t num = rand() % i;
+		lct.Link(node[i], node[num]);
+		clct.Link(cnode[i], cnode[num]);
+	}
+
+	for (size_t i = 0; i < N; ++i) {
+		size_t a = rand() % N, b = rand() % N;
+		assert(lct.Path(node[a]).sum == clct.Path(cnode[a]).sum);
+		assert(lct.FindRoot(node[a])->key == clct.Key(clct.FindRoot(cnode[a])));
+		typename LCT::Node *p = lct.Parent(node[a]);
+		CNode cp = clct.Parent(cnode[a]);
+		assert((!p && cp == CLCT::NIL) || (p && p->key == clct.Key(cp)));
+		typename LCT::Node *lca = lct.FindLCA(node[a], node[b]);
+		CNode clca = clct.FindLCA(cnode[a], cnode[b]);
+		assert((!lca && clca == CLCT::NIL) || (lca && lca->key == clct.Key(clca)));
+		assert(lct.IsRoot(node[a]) == clct.IsRoot(cnode[a]));
+
+		// Move a random subtree under a vertex outside of it
+		size_t f = rand() % N;
+		if (Evertable && rand() % 2) {
+			lct.Evert(node[f]);
+			clct.Evert(cnode[f]);
+		}
+		lct.Cut(node[f]), clct.Cut(cnode[f]);
+		size_t t = rand() % N;
+		if (lct.FindRoot(node[t]) != node[f]) {
+			lct.Link(node[f], node[t]);
+			clct.Link(cnode[f], cnode[t]);
+		}
+	}
+
+	// Removed slots are reused
+	clct.Cut(cnode[0]);
+	for (size_t i = 1; i < N; ++i)
+		if (clct.Parent(cnode[i]) == cnode[0]) clct.Cut(cnode[i]);
+	clct.Remove(cnode[0]);
+	assert(clct.Add(7) == cnode[0] && clct.Size() == N);
+
+	std::cout << "Compact " << (Evertable?"evertable ":"") << "test Done" << std::endl;
+}
+
+// Statistics on the duplicate counter see one per vertex, the path size
+// is the depth plus one
+void compact_size_test(size_t N) {
+	typedef CompactLinkCutTree<size_t, SizeStatistic<>, true> CLCT;
+	CLCT clct;
+	vector<size_t> depth(N, 0);
+	vector<typename CLCT::Node> cnode;
+	for (size_t i = 0; i < N; ++i) {
+		cnode.push_back(clct.Add(i));
+		if (i == 0) continue;
+		size_t p = rand() % i;
+		clct.Link(cnode[i], cnode[p]);
+		depth[i] = depth[p] + 1;
+	}
+	for (size_t i = 0; i < N; ++i) assert(clct.Path(cnode[i]).ss == depth[i] + 1);
+	clct.Evert(cnode[N - 1]);
+	assert(clct.Path(cnode[0]).ss == depth[N - 1] + 1);
+	std::cout << "Compact size test Done" << std::endl;
+}
+
+void compact_layout_test() {
+	typedef LinkCutTree<size_t, SumStatistic<size_t> > LCT;
+	typedef CompactLinkCutTree<size_t, Sum> CLCT;
+	assert(2 * CLCT::NodeBytes() <= sizeof(typename LCT::Node));
+	std::cout << "Bytes per node: " << sizeof(typename LCT::Node)
+		<< " -> " << CLCT::NodeBytes() << std::endl;
+}
+
+int main(int argc, const char *argv[])
+{
+	compact_layout_test();
+	compact_link_cut_tree_test<false>(10000);
+	compact_link_cut_tree_test<true>(10000);
+	compact_size_test(1000);
+	return 0;
+}
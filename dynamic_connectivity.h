@@ -0,0 +1,280 @@
+#ifndef __DYNAMIC_CONNECTIVITY_H__
+#define __DYNAMIC_CONNECTIVITY_H__
+
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <utility>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "euler_tree.h"
+
+// Per vertex counters of one level: edges of exactly this level
+struct LevelVertex {
+	size_t id;
+	size_t tree, nontree;
+	LevelVertex(size_t id) : id(id), tree(0), nontree(0) {}
+};
+
+// Vertex count of a range of the tour and whether some vertex in it has
+// tree or non-tree edges of the level. Counted at representatives only.
+class LevelStatistic : public Statistic {
+public:
+	size_t size;
+	bool tree, nontree;
+	LevelStatistic() : Statistic(), size(0), tree(false), nontree(false) {}
+
+	template <typename Key>
+	void Init(const Key& key) {
+		bool repr = key.node->repr && &(key.node->repr->key) == &key;
+		size = repr;
+		tree = repr && key.node->key.tree;
+		nontree = repr && key.node->key.nontree;
+	}
+
+	void UpdateLeft(const LevelStatistic& s) {
+		Update(s);
+	}
+
+	void UpdateRight(const LevelStatistic& s) {
+		Update(s);
+	}
+
+	void Update(const LevelStatistic& s) {
+		size += s.size;
+		tree = tree || s.tree;
+		nontree = nontree || s.nontree;
+	}
+};
+
+// Fully dynamic connectivity (Holm, de Lichtenberg and Thorup).
+// Every edge has a level, starting at 0. Level i keeps a spanning forest
+// F_i of the tree edges of level >= i, so F_0 spans the whole graph and
+// trees of F_i have at most n / 2^i vertices. Deleting a tree edge of
+// level l searches levels l..0 for a replacement: the smaller side pays
+// for the search by pushing its edges one level up.
+// O(log^2 n) amortized per update and O(log n) per query.
+template <class Alloc = PoolAllocator>
+class DynamicConnectivity {
+public:
+	typedef EulerTree<LevelVertex, true, LevelStatistic, Alloc> Forest;
+	typedef typename Forest::Node Node;
+	typedef typename Forest::STNode STNode;
+	typedef typename Forest::ST ST;
+
+	DynamicConnectivity(size_t n) : n(n), edge_count(0) {
+		size_t levels = 1;
+		while ((size_t(1) << levels) < n) ++levels;
+		this->levels.resize(levels);
+		NewLevel(0);
+		for (size_t v = 0 ; v < n ; ++v) Vertex(0, v);
+	}
+
+	DynamicConnectivity(const DynamicConnectivity &) = delete;
+
+	// Returns false if the edge exists already
+	bool InsertEdge(size_t u, size_t v) {
+		assert(u < n && v < n);
+		if (u == v || edges.count(Key(u, v))) return false;
+		EdgeInfo &e = edges[Key(u, v)];
+		++edge_count;
+		if (!Connected(u, v)) {
+			e.tree = true;
+			e.handles.push_back(LinkAt(0, u, v));
+			AddTreeEdge(0, u, v);
+		} else {
+			AddNontreeEdge(0, u, v);
+		}
+		return true;
+	}
+
+	// Returns false if there is no such edge
+	bool DeleteEdge(size_t u, size_t v) {
+		assert(u < n && v < n);
+		typename std::unordered_map<uint64_t, EdgeInfo>::iterator it = edges.find(Key(u, v));
+		if (it == edges.end()) return false;
+		EdgeInfo e = it->second;
+		edges.erase(it);
+		--edge_count;
+		if (!e.tree) {
+			RemoveNontreeEdge(e.level, u, v);
+			return true;
+		}
+		RemoveTreeEdge(e.level, u, v);
+		for (size_t i = 0 ; i <= e.level ; ++i) levels[i]->forest.Cut(e.handles[i]);
+		for (size_t i = e.level + 1 ; i --> 0 ;)
+			if (Replace(i, u, v)) break;
+		return true;
+	}
+
+	bool Connected(size_t u, size_t v) {
+		Forest &f = levels[0]->forest;
+		return f.FindRoot(levels[0]->vertex[u]) == f.FindRoot(levels[0]->vertex[v]);
+	}
+
+	// Number of vertices connected to u (u included)
+	size_t ComponentSize(size_t u) {
+		return TreeStat(0, u).size;
+	}
+
+	size_t Size() const {
+		return n;
+	}
+
+	size_t Edges() const {
+		return edge_count;
+	}
+
+private:
+	struct EdgeInfo {
+		size_t level;
+		bool tree;
+		std::vector<typename Forest::Edge> handles; // one per level <= level
+		EdgeInfo() : level(0), tree(false) {}
+	};
+
+	typedef std::unordered_map<size_t, std::unordered_set<size_t> > Adjacency;
+
+	struct Level {
+		Forest forest;
+		std::vector<Node *> vertex; // created on first use
+		Adjacency tree, nontree; // edges of exactly this level
+	};
+
+	static uint64_t Key(size_t u, size_t v) {
+		if (u > v) std::swap(u, v);
+		return (uint64_t(u) << 32) | v;
+	}
+
+	void NewLevel(size_t i) {
+		if (levels[i]) return;
+		levels[i].reset(new Level());
+		levels[i]->vertex.assign(n, nullptr);
+	}
+
+	Node *Vertex(size_t i, size_t v) {
+		NewLevel(i);
+		Node *&x = levels[i]->vertex[v];
+		if (!x) x = levels[i]->forest.Add(LevelVertex(v));
+		return x;
+	}
+
+	typename Forest::Edge LinkAt(size_t i, size_t u, size_t v) {
+		Node *x = Vertex(i, u), *y = Vertex(i, v);
+		Forest &f = levels[i]->forest;
+		f.Evert(x);
+		return f.Link(x, y);
+	}
+
+	// Splay root of the tour holding v at level i
+	STNode *TourRoot(size_t i, size_t v) {
+		STNode *x = Vertex(i, v)->repr;
+		ST::SplayNode(x);
+		return x;
+	}
+
+	LevelStatistic TreeStat(size_t i, size_t v) {
+		return TourRoot(i, v)->stat;
+	}
+
+	// Counters of (i, v) changed by d
+	void Count(size_t i, size_t v, size_t LevelVertex::*counter, int d) {
+		Node *x = Vertex(i, v);
+		x->key.*counter += d;
+		levels[i]->forest.UpdateKey(x);
+	}
+
+	void AddTreeEdge(size_t i, size_t u, size_t v) {
+		levels[i]->tree[u].insert(v), levels[i]->tree[v].insert(u);
+		Count(i, u, &LevelVertex::tree, 1), Count(i, v, &LevelVertex::tree, 1);
+	}
+
+	void RemoveTreeEdge(size_t i, size_t u, size_t v) {
+		Erase(levels[i]->tree, u, v), Erase(levels[i]->tree, v, u);
+		Count(i, u, &LevelVertex::tree, -1), Count(i, v, &LevelVertex::tree, -1);
+	}
+
+	void AddNontreeEdge(size_t i, size_t u, size_t v) {
+		levels[i]->nontree[u].insert(v), levels[i]->nontree[v].insert(u);
+		Count(i, u, &LevelVertex::nontree, 1), Count(i, v, &LevelVertex::nontree, 1);
+	}
+
+	void RemoveNontreeEdge(size_t i, size_t u, size_t v) {
+		Erase(levels[i]->nontree, u, v), Erase(levels[i]->nontree, v, u);
+		Count(i, u, &LevelVertex::nontree, -1), Count(i, v, &LevelVertex::nontree, -1);
+	}
+
+	static void Erase(Adjacency &adj, size_t u, size_t v) {
+		typename Adjacency::iterator it = adj.find(u);
+		assert(it != adj.end());
+		it->second.erase(v);
+		if (it->second.empty()) adj.erase(it);
+	}
+
+	// A vertex of the tour under root whose flag is set, or n if none
+	size_t FindFlagged(STNode *root, bool LevelStatistic::*flag) {
+		if (!(root->stat.*flag)) return n;
+		STNode *cur = root;
+		while (true) {
+			if (cur->Left() && cur->Left()->stat.*flag) cur = cur->Left();
+			else {
+				LevelStatistic self;
+				self.Init(cur->key);
+				if (self.*flag) break;
+				cur = cur->Right();
+				assert(cur && cur->stat.*flag);
+			}
+		}
+		ST::SplayNode(cur); // Amortization
+		return cur->key.node->key.id;
+	}
+
+	// u and v were split at level i, look for an edge of level i joining
+	// them again. The smaller side pushes its level i edges one level up.
+	bool Replace(size_t i, size_t u, size_t v) {
+		Forest &f = levels[i]->forest;
+		if (TreeStat(i, u).size > TreeStat(i, v).size) std::swap(u, v);
+		Node *big = f.FindRoot(Vertex(i, v));
+		bool next = i + 1 < levels.size();
+
+		// Tree edges of level i inside the small tree go up
+		for (size_t x ; next && (x = FindFlagged(TourRoot(i, u), &LevelStatistic::tree)) != n ;) {
+			while (levels[i]->tree.count(x)) {
+				size_t y = *levels[i]->tree[x].begin();
+				RemoveTreeEdge(i, x, y);
+				EdgeInfo &e = edges[Key(x, y)];
+				e.level = i + 1;
+				e.handles.push_back(LinkAt(i + 1, x, y));
+				AddTreeEdge(i + 1, x, y);
+			}
+		}
+
+		// Non-tree edges of level i leaving the small tree reconnect it,
+		// the others go up
+		for (size_t x ; (x = FindFlagged(TourRoot(i, u), &LevelStatistic::nontree)) != n ;) {
+			while (levels[i]->nontree.count(x)) {
+				size_t y = *levels[i]->nontree[x].begin();
+				RemoveNontreeEdge(i, x, y);
+				EdgeInfo &e = edges[Key(x, y)];
+				if (f.FindRoot(Vertex(i, y)) == big) {
+					e.tree = true;
+					for (size_t j = 0 ; j <= i ; ++j) e.handles.push_back(LinkAt(j, x, y));
+					AddTreeEdge(i, x, y);
+					return true;
+				}
+				assert(next);
+				e.level = i + 1;
+				AddNontreeEdge(i + 1, x, y);
+			}
+		}
+		return false;
+	}
+
+	size_t n, edge_count;
+	std::vector<std::unique_ptr<Level> > levels;
+	std::unordered_map<uint64_t, EdgeInfo> edges;
+};
+
+#endif /* __DYNAMIC_CONNECTIVITY_H__ */
@@ -0,0 +1,144 @@
+#include <iostream>
+#include <vector>
+#include <cstdlib>
+#include <chrono>
+#include <unordered_set>
+#include <utility>
+
+#include "dynamic_connectivity.h"
+
+using namespace std;
+
+// Baseline: union-find rebuilt from the whole edge set after any delete
+class Rebuild {
+public:
+	Rebuild(size_t n) : n(n), dirty(false), parent(n) {
+		for (size_t i = 0 ; i < n ; ++i) parent[i] = i;
+	}
+
+	void InsertEdge(size_t u, size_t v) {
+		edges.insert(Key(u, v));
+		if (!dirty) Union(u, v);
+	}
+
+	void DeleteEdge(size_t u, size_t v) {
+		edges.erase(Key(u, v));
+		dirty = true;
+	}
+
+	bool Connected(size_t u, size_t v) {
+		if (dirty) {
+			for (size_t i = 0 ; i < n ; ++i) parent[i] = i;
+			for (unordered_set<uint64_t>::iterator it = edges.begin() ; it != edges.end() ; ++it)
+				Union(*it >> 32, *it & 0xffffffffu);
+			dirty = false;
+		}
+		return Find(u) == Find(v);
+	}
+
+private:
+	static uint64_t Key(size_t u, size_t v) {
+		if (u > v) swap(u, v);
+		return (uint64_t(u) << 32) | v;
+	}
+
+	size_t Find(size_t v) {
+		while (parent[v] != v) v = parent[v] = parent[parent[v]];
+		return v;
+	}
+
+	void Union(size_t u, size_t v) {
+		u = Find(u), v = Find(v);
+		if (u != v) parent[u] = v;
+	}
+
+	size_t n;
+	bool dirty;
+	vector<size_t> parent;
+	unordered_set<uint64_t> edges;
+};
+
+struct Op {
+	enum Type { INSERT, DELETE, QUERY } type;
+	size_t u, v;
+	Op(Type t, size_t u, size_t v) : type(t), u(u), v(v) {}
+};
+
+// Random graph with about 2n edges; inserts, deletes and queries in equal parts
+vector<Op> random_stream(size_t n, size_t ops) {
+	vector<Op> stream;
+	vector<pair<size_t, size_t> > edges;
+	unordered_set<uint64_t> present;
+	for (size_t k = 0 ; k < ops ; ++k) {
+		int t = rand() % 3;
+		size_t u = rand() % n, v = rand() % n;
+		if (t == 0 || (t == 1 && edges.size() < n)) {
+			uint64_t key = (uint64_t(min(u, v)) << 32) | max(u, v);
+			if (u == v || !present.insert(key).second) continue;
+			edges.push_back(make_pair(u, v));
+			stream.push_back(Op(Op::INSERT, u, v));
+		} else if (t == 1) {
+			size_t i = rand() % edges.size();
+			pair<size_t, size_t> e = edges[i];
+			edges[i] = edges.back(), edges.pop_back();
+			present.erase((uint64_t(min(e.first, e.second)) << 32) | max(e.first, e.second));
+			stream.push_back(Op(Op::DELETE, e.first, e.second));
+		} else {
+			stream.push_back(Op(Op::QUERY, u, v));
+		}
+	}
+	return stream;
+}
+
+// A cycle whose tree edges are deleted and inserted back one after
+// another, with a query after each delete. Every delete needs a
+// replacement search and every query sees a changed graph.
+vector<Op> adversarial_stream(size_t n, size_t ops) {
+	vector<Op> stream;
+	for (size_t i = 0 ; i < n ; ++i) stream.push_back(Op(Op::INSERT, i, (i + 1) % n));
+	for (size_t k = 0 ; stream.size() < ops ; ++k) {
+		size_t i = (k * 7919) % n, j = (i + 1) % n;
+		stream.push_back(Op(Op::DELETE, i, j));
+		stream.push_back(Op(Op::QUERY, rand() % n, rand() % n));
+		stream.push_back(Op(Op::INSERT, i, j));
+	}
+	return stream;
+}
+
+template <class Graph>
+double run(Graph &g, const vector<Op> &stream, size_t &check) {
+	chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+	for (size_t i = 0 ; i < stream.size() ; ++i) {
+		const Op &op = stream[i];
+		switch (op.type) {
+			case Op::INSERT: g.InsertEdge(op.u, op.v); break;
+			case Op::DELETE: g.DeleteEdge(op.u, op.v); break;
+			case Op::QUERY: check = check * 3 + g.Connected(op.u, op.v); break;
+		}
+	}
+	return chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+}
+
+void bench(const char *name, size_t n, const vector<Op> &stream) {
+	size_t dc_check = 0, rebuild_check = 0;
+	DynamicConnectivity<> dc(n);
+	Rebuild rebuild(n);
+	double dc_time = run(dc, stream, dc_check);
+	double rebuild_time = run(rebuild, stream, rebuild_check);
+	cout << name << " (n = " << n << "): rebuild " << size_t(stream.size() / rebuild_time)
+		<< " ops/s, dynamic " << size_t(stream.size() / dc_time) << " ops/s, speedup "
+		<< rebuild_time / dc_time << (dc_check == rebuild_check?"":" (MISMATCH)") << endl;
+}
+
+int main(int argc, const char *argv[])
+{
+	size_t ops = argc > 1?atol(argv[1]):100000;
+	srand(1);
+	size_t sizes[] = {1000, 10000, 50000};
+	for (size_t i = 0 ; i < 3 ; ++i) {
+		size_t n = sizes[i];
+		bench("random", n, random_stream(n, ops));
+		bench("adversarial", n, adversarial_stream(n, ops));
+	}
+	return 0;
+}
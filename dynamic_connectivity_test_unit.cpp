@@ -0,0 +1,89 @@
+#include <iostream>
+#include <vector>
+#include <set>
+#include <utility>
+#include <cstdlib>
+#include <cassert>
+
+#include "dynamic_connectivity.h"
+
+using namespace std;
+
+// Component labels of the graph by DFS
+vector<size_t> Components(size_t n, const set<pair<size_t, size_t> > &edges) {
+	vector<vector<size_t> > adj(n);
+	for (set<pair<size_t, size_t> >::const_iterator it = edges.begin() ; it != edges.end() ; ++it)
+		adj[it->first].push_back(it->second), adj[it->second].push_back(it->first);
+	vector<size_t> label(n, n), stack;
+	for (size_t s = 0 ; s < n ; ++s) {
+		if (label[s] != n) continue;
+		label[s] = s, stack.push_back(s);
+		while (!stack.empty()) {
+			size_t v = stack.back();
+			stack.pop_back();
+			for (size_t i = 0 ; i < adj[v].size() ; ++i)
+				if (label[adj[v][i]] == n) label[adj[v][i]] = s, stack.push_back(adj[v][i]);
+		}
+	}
+	return label;
+}
+
+void RandomTest(size_t n, size_t ops, size_t density) {
+	DynamicConnectivity<> dc(n);
+	set<pair<size_t, size_t> > edges;
+	for (size_t k = 0 ; k < ops ; ++k) {
+		size_t u = rand() % n, v = rand() % n;
+		if (u > v) swap(u, v);
+		// Keep around density * n edges
+		if (u != v && rand() % (2 * density) >= edges.size() * 2 / n) {
+			bool inserted = edges.insert(make_pair(u, v)).second;
+			assert(dc.InsertEdge(u, v) == inserted);
+		} else if (!edges.empty()) {
+			set<pair<size_t, size_t> >::iterator it = edges.lower_bound(make_pair(u, v));
+			if (it == edges.end()) it = edges.begin();
+			assert(dc.DeleteEdge(it->first, it->second));
+			assert(!dc.DeleteEdge(it->first, it->second));
+			edges.erase(it);
+		}
+		assert(dc.Edges() == edges.size());
+		if (k % 16) continue;
+		vector<size_t> label = Components(n, edges), size(n, 0);
+		for (size_t i = 0 ; i < n ; ++i) ++size[label[i]];
+		for (size_t i = 0 ; i < n ; ++i) {
+			size_t j = rand() % n;
+			assert(dc.Connected(i, j) == (label[i] == label[j]));
+			assert(dc.ComponentSize(i) == size[label[i]]);
+		}
+	}
+	std::cout << "Random test (density " << density << ") Done" << std::endl;
+}
+
+// Every delete on a cycle hits the tree edge just inserted back as a
+// non-tree one, the replacement is found on the far side of the cycle
+void CycleTest(size_t n, size_t rounds) {
+	DynamicConnectivity<> dc(n);
+	for (size_t i = 0 ; i < n ; ++i) assert(dc.InsertEdge(i, (i + 1) % n));
+	for (size_t k = 0 ; k < rounds ; ++k) {
+		size_t i = k % n;
+		assert(dc.DeleteEdge(i, (i + 1) % n));
+		assert(dc.Connected(i, (i + 1) % n));
+		assert(dc.ComponentSize(i) == n);
+		assert(dc.InsertEdge(i, (i + 1) % n));
+	}
+	// Two cuts split the cycle into arcs
+	assert(dc.DeleteEdge(0, 1));
+	assert(dc.DeleteEdge(n / 2, n / 2 + 1));
+	assert(!dc.Connected(0, 1) && dc.Connected(1, n / 2));
+	assert(dc.ComponentSize(0) == n - n / 2 && dc.ComponentSize(1) == n / 2);
+	std::cout << "Cycle test Done" << std::endl;
+}
+
+int main(int argc, const char *argv[])
+{
+	srand(1);
+	RandomTest(50, 20000, 1);
+	RandomTest(50, 20000, 3);
+	RandomTest(300, 20000, 2);
+	CycleTest(1000, 5000);
+	return 0;
+}
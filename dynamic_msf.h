@@ -0,0 +1,124 @@
+#ifndef __DYNAMIC_MSF_H__
+#define __DYNAMIC_MSF_H__
+
+#include <cassert>
+#include <limits>
+#include <vector>
+#include <unordered_map>
+
+#include "statistics.h"
+#include "link_cut_tree.h"
+
+// Minimum spanning forest of a graph whose weighted edges come in one by
+// one. The forest is an evertable link cut tree in which every tree edge
+// is a node of its own between its two vertices, keyed by its weight
+// (vertices hold the lowest weight), so the heaviest edge of a tree path
+// and where it is come from one Path() of MinMaxStatistic with Arg.
+// An edge closing a cycle replaces the heaviest edge on it when lighter.
+// O(log n) amortized per insert and query.
+template <class W = long, class Alloc = PoolAllocator>
+class DynamicMSF {
+public:
+	typedef MinMaxStatistic<W, Statistic, true> PathStatistic;
+	typedef LinkCutTree<W, PathStatistic, true, Alloc> Forest;
+	typedef typename Forest::Node Node;
+
+	struct Edge {
+		size_t u, v;
+		W weight;
+	};
+
+	DynamicMSF(size_t n) : n(n), total() {
+		for (size_t v = 0 ; v < n ; ++v) vertex.push_back(forest.Add(std::numeric_limits<W>::lowest()));
+	}
+
+	DynamicMSF(const DynamicMSF &) = delete;
+
+	// Adds the edge (u, v) of weight w to the graph. It joins the forest
+	// if it connects two trees, or if it is lighter than the heaviest edge
+	// of the tree path from u to v, which then leaves. Returns whether it
+	// joined
+	bool InsertEdge(size_t u, size_t v, W w) {
+		assert(u < n && v < n);
+		if (u == v) return false;
+		forest.Evert(vertex[u]);
+		if (forest.FindRoot(vertex[v]) == vertex[u]) {
+			PathStatistic s = forest.Path(vertex[v]);
+			if (!(w < s.max_weight)) return false;
+			RemoveTreeEdge(slot.at(s.max_key));
+		}
+		AddTreeEdge(u, v, w);
+		return true;
+	}
+
+	bool Connected(size_t u, size_t v) {
+		assert(u < n && v < n);
+		return forest.FindRoot(vertex[u]) == forest.FindRoot(vertex[v]);
+	}
+
+	// Heaviest forest edge between the connected u != v
+	Edge PathMax(size_t u, size_t v) {
+		assert(u != v && Connected(u, v));
+		forest.Evert(vertex[u]);
+		return edges[slot.at(forest.Path(vertex[v]).max_key)];
+	}
+
+	// Total weight of the forest
+	W Weight() const {
+		return total;
+	}
+
+	std::vector<Edge> TreeEdges() const {
+		std::vector<Edge> ret;
+		for (size_t i = 0 ; i < edges.size() ; ++i)
+			if (edge_node[i]) ret.push_back(edges[i]);
+		return ret;
+	}
+
+	size_t Size() const {
+		return n;
+	}
+
+	// Edges in the forest
+	size_t Edges() const {
+		return edges.size() - free.size();
+	}
+
+private:
+	void AddTreeEdge(size_t u, size_t v, W w) {
+		size_t i = edges.size();
+		if (free.empty()) edges.push_back(Edge()), edge_node.push_back(NULL);
+		else i = free.back(), free.pop_back();
+		Edge &e = edges[i];
+		e.u = u, e.v = v, e.weight = w;
+		Node *x = edge_node[i] = forest.Add(w);
+		slot[&x->key] = i;
+		forest.Link(x, vertex[u]);
+		forest.Evert(vertex[v]);
+		forest.Link(vertex[v], x);
+		total += w;
+	}
+
+	void RemoveTreeEdge(size_t i) {
+		Node *x = edge_node[i];
+		forest.Evert(x);
+		forest.Cut(vertex[edges[i].u]);
+		forest.Cut(vertex[edges[i].v]);
+		slot.erase(&x->key);
+		forest.Remove(x);
+		edge_node[i] = NULL;
+		free.push_back(i);
+		total -= edges[i].weight;
+	}
+
+	size_t n;
+	W total;
+	Forest forest;
+	std::vector<Node *> vertex;
+	std::vector<Edge> edges; // forest edges by slot
+	std::vector<Node *> edge_node; // NULL for a free slot
+	std::vector<size_t> free;
+	std::unordered_map<const W *, size_t> slot; // key of an edge node to its slot
+};
+
+#endif /* __DYNAMIC_MSF_H__ */
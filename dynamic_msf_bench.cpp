@@ -0,0 +1,117 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <chrono>
+
+#include "dynamic_msf.h"
+
+using namespace std;
+
+struct WeightedEdge {
+	size_t u, v;
+	long w;
+	bool operator<(const WeightedEdge& o) const { return w < o.w; }
+};
+
+// Baseline: Kruskal rerun when the weight is asked for after inserts.
+// Over every edge so far, or, incremental, over the last forest and the
+// edges since (the forest of the graph keeps only edges of those)
+class Kruskal {
+public:
+	Kruskal(size_t n, bool incremental) : n(n), incremental(incremental), total(0), parent(n) {}
+
+	bool InsertEdge(size_t u, size_t v, long w) {
+		WeightedEdge e = { u, v, w };
+		pending.push_back(e);
+		return true;
+	}
+
+	long Weight() {
+		if (pending.empty()) return total;
+		if (incremental) edges.swap(forest);
+		edges.insert(edges.end(), pending.begin(), pending.end());
+		pending.clear();
+		sort(edges.begin(), edges.end());
+		for (size_t i = 0 ; i < n ; ++i) parent[i] = i;
+		forest.clear();
+		total = 0;
+		for (size_t i = 0 ; i < edges.size() ; ++i) {
+			size_t a = Find(edges[i].u), b = Find(edges[i].v);
+			if (a == b) continue;
+			parent[a] = b;
+			forest.push_back(edges[i]);
+			total += edges[i].w;
+		}
+		if (incremental) edges.clear();
+		return total;
+	}
+
+private:
+	size_t Find(size_t v) {
+		while (parent[v] != v) v = parent[v] = parent[parent[v]];
+		return v;
+	}
+
+	size_t n;
+	bool incremental;
+	long total;
+	vector<size_t> parent;
+	vector<WeightedEdge> edges, pending, forest;
+};
+
+vector<WeightedEdge> random_stream(size_t n, size_t m) {
+	vector<WeightedEdge> stream;
+	for (size_t i = 0 ; i < m ; ++i) {
+		WeightedEdge e = { rand() % n, rand() % n, long(rand() % 1000000) };
+		stream.push_back(e);
+	}
+	return stream;
+}
+
+// Inserts of the stream, the forest weight asked for after every `every`
+template <class Graph>
+double run(Graph &g, const vector<WeightedEdge> &stream, size_t every, long &check) {
+	chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+	for (size_t i = 0 ; i < stream.size() ; ++i) {
+		g.InsertEdge(stream[i].u, stream[i].v, stream[i].w);
+		if ((i + 1) % every == 0) check = check * 3 + g.Weight();
+	}
+	return chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+}
+
+void row(const char *name, size_t every, size_t m, double time, bool ok) {
+	cout << "  " << left << setw(22) << name << " weight every " << setw(7) << every << right
+		<< setw(12) << size_t(m / time) << " inserts/s" << (ok?"":" (MISMATCH)") << endl;
+}
+
+void bench(size_t n, size_t m) {
+	vector<WeightedEdge> stream = random_stream(n, m);
+	cout << "random (n = " << n << ", m = " << m << ")" << endl;
+	size_t everies[] = {1, 100, m / 20};
+	for (size_t k = 0 ; k < 3 ; ++k) {
+		size_t every = everies[k];
+		long dynamic_check = 0, incremental_check = 0, full_check = 0;
+		DynamicMSF<long> msf(n);
+		double dynamic_time = run(msf, stream, every, dynamic_check);
+		row("dynamic", every, m, dynamic_time, true);
+		if ((n + every) * (m / every) > 500000000) continue; // a rerun per query is far too slow
+		Kruskal incremental(n, true);
+		double incremental_time = run(incremental, stream, every, incremental_check);
+		row("Kruskal, incremental", every, m, incremental_time, incremental_check == dynamic_check);
+		if (every < m / 20) continue;
+		Kruskal full(n, false);
+		double full_time = run(full, stream, every, full_check);
+		row("Kruskal, all edges", every, m, full_time, full_check == dynamic_check);
+	}
+}
+
+int main(int argc, const char *argv[])
+{
+	size_t m = argc > 1?atol(argv[1]):200000;
+	srand(1);
+	size_t sizes[] = {1000, 10000, 100000};
+	for (size_t i = 0 ; i < 3 ; ++i) bench(sizes[i], m);
+	return 0;
+}
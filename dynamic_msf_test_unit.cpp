@@ -0,0 +1,111 @@
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <cassert>
+
+#include "dynamic_msf.h"
+
+using namespace std;
+
+typedef DynamicMSF<long> MSF;
+
+struct WeightedEdge {
+	size_t u, v;
+	long w;
+	bool operator<(const WeightedEdge& o) const { return w < o.w; }
+};
+
+size_t find(vector<size_t> &parent, size_t x) {
+	while (parent[x] != x) x = parent[x] = parent[parent[x]];
+	return x;
+}
+
+// Weight and edge count of a minimum spanning forest of all the edges
+pair<long, size_t> kruskal(size_t n, vector<WeightedEdge> edges) {
+	sort(edges.begin(), edges.end());
+	vector<size_t> parent(n);
+	for (size_t i = 0 ; i < n ; ++i) parent[i] = i;
+	pair<long, size_t> ret(0, 0);
+	for (size_t i = 0 ; i < edges.size() ; ++i) {
+		size_t a = find(parent, edges[i].u), b = find(parent, edges[i].v);
+		if (a == b) continue;
+		parent[a] = b;
+		ret.first += edges[i].w, ++ret.second;
+	}
+	return ret;
+}
+
+// Heaviest edge weight on the path from u to v in the forest, -1 if none
+long path_max(size_t n, const vector<MSF::Edge> &forest, size_t u, size_t v) {
+	vector<vector<pair<size_t, long> > > adj(n);
+	for (size_t i = 0 ; i < forest.size() ; ++i) {
+		adj[forest[i].u].push_back(make_pair(forest[i].v, forest[i].weight));
+		adj[forest[i].v].push_back(make_pair(forest[i].u, forest[i].weight));
+	}
+	vector<long> best(n, -2);
+	vector<size_t> stack(1, u);
+	best[u] = -1;
+	while (!stack.empty()) {
+		size_t x = stack.back();
+		stack.pop_back();
+		for (size_t i = 0 ; i < adj[x].size() ; ++i) {
+			size_t y = adj[x][i].first;
+			if (best[y] != -2) continue;
+			best[y] = max(best[x], adj[x][i].second);
+			stack.push_back(y);
+		}
+	}
+	return best[v];
+}
+
+// Every insert against Kruskal on all the edges so far
+void dynamic_msf_test(size_t n, size_t m, long weights) {
+	MSF msf(n);
+	vector<WeightedEdge> edges;
+	for (size_t i = 0 ; i < m ; ++i) {
+		WeightedEdge e = { rand() % n, rand() % n, rand() % weights };
+		msf.InsertEdge(e.u, e.v, e.w);
+		edges.push_back(e);
+		pair<long, size_t> expected = kruskal(n, edges);
+		assert(msf.Weight() == expected.first && msf.Edges() == expected.second);
+
+		size_t u = rand() % n, v = rand() % n;
+		vector<MSF::Edge> forest = msf.TreeEdges();
+		assert(forest.size() == msf.Edges());
+		long heaviest = path_max(n, forest, u, v);
+		assert(msf.Connected(u, v) == (heaviest != -2));
+		if (u != v && heaviest >= 0) {
+			MSF::Edge e = msf.PathMax(u, v);
+			assert(e.weight == heaviest && path_max(n, forest, e.u, e.v) == heaviest);
+		}
+	}
+	std::cout << "Dynamic MSF test Done" << std::endl;
+}
+
+// A cycle closed by ever lighter edges keeps the lightest ones
+void cycle_test(size_t n) {
+	MSF msf(n);
+	for (size_t i = 0 ; i + 1 < n ; ++i) assert(msf.InsertEdge(i, i + 1, 1000 + i));
+	assert(msf.Edges() == n - 1);
+	assert(msf.PathMax(0, n - 1).weight == long(1000 + n - 2));
+	assert(!msf.InsertEdge(0, n - 1, 5000));
+	// The first chord drops the heaviest path edge, then each the last chord
+	for (size_t i = 0 ; i < 100 ; ++i) {
+		assert(msf.InsertEdge(0, n - 1, 999 - i));
+		assert(msf.Edges() == n - 1 && msf.PathMax(0, n - 1).weight == long(999 - i));
+	}
+	long expected = 999 - 99;
+	for (size_t i = 0 ; i + 2 < n ; ++i) expected += 1000 + i;
+	assert(msf.Weight() == expected);
+	assert(!msf.InsertEdge(3, 3, 0));
+	std::cout << "Cycle test Done" << std::endl;
+}
+
+int main(int argc, const char *argv[])
+{
+	dynamic_msf_test(50, 1000, 1000);
+	dynamic_msf_test(200, 1000, 4); // many ties
+	cycle_test(100);
+	return 0;
+}
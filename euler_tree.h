@@ -1,11 +1,106 @@
 #ifndef __EULER_TREE_H__
 #define __EULER_TREE_H__
 
-#include <unordered_set>
+#include <cstring>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <utility>
+#include <unordered_map>
+
 #include "splay_tree.h"
 #include "statistics.h"
+#include "frozen_forest.h"
+
+template <class STNode, bool Evertable>
+struct OccurRing {
+	static void InsertAfter(STNode *last, STNode *x) {}
+	static void Erase(STNode *x) {}
+	// Not evertable, the representative is the first occurrence
+	template <class ST>
+	static STNode *First(STNode *x) { return x; }
+};
+
+// Occurrences of a vertex in an evertable tree also form a small splay
+// tree in ring order. The ring is a rotation of the tour order, so the
+// first occurrence is found by binary search instead of a ring walk.
+template <class STNode>
+struct OccurRing<STNode, true> {
+	STNode *rp, *rl, *rr;
+	OccurRing() : rp(nullptr), rl(nullptr), rr(nullptr) {}
+
+	// Insert x right after last in ring order
+	static void InsertAfter(STNode *last, STNode *x) {
+		Splay(last);
+		OccurRing &l = last->key, &k = x->key;
+		k.rl = nullptr;
+		k.rr = l.rr;
+		if (k.rr) k.rr->key.rp = x;
+		l.rr = x;
+		k.rp = last;
+	}
+
+	static void Erase(STNode *x) {
+		Splay(x);
+		STNode *l = x->key.rl, *r = x->key.rr;
+		x->key.rl = x->key.rr = nullptr;
+		if (r) r->key.rp = nullptr;
+		if (!l) return;
+		l->key.rp = nullptr;
+		while (l->key.rr) l = l->key.rr;
+		Splay(l);
+		l->key.rr = r;
+		if (r) r->key.rp = l;
+	}
 
-template <class T, bool Evertable = true, class Stat = Statistic>
+	// First occurrence in tour order among the ring of x.
+	// Taking the ring from its head, occurrences after the head in the
+	// tour come first, then those before it, so the answer is the first
+	// one before the head.
+	template <class ST>
+	static STNode *First(STNode *x) {
+		Splay(x);
+		while (x->key.rl) x = x->key.rl;
+		Splay(x);
+		STNode *head = x, *first = x, *cur = x->key.rr;
+		while (cur) {
+			x = cur;
+			if (ST::InOrder(cur, head)) first = cur, cur = cur->key.rl;
+			else cur = cur->key.rr;
+		}
+		Splay(x); // Amortization
+		return first;
+	}
+
+	static void Splay(STNode *x) {
+		while (x->key.rp) {
+			STNode *y = x->key.rp, *z = y->key.rp;
+			if (!z) Rotate(x);
+			else if ((z->key.rl == y) == (y->key.rl == x)) Rotate(y), Rotate(x);
+			else Rotate(x), Rotate(x);
+		}
+	}
+
+	static void Rotate(STNode *x) {
+		STNode *y = x->key.rp, *z = y->key.rp;
+		if (z) (z->key.rl == y)?(z->key.rl = x):(z->key.rr = x);
+		x->key.rp = z;
+		y->key.rp = x;
+		if (y->key.rl == x) {
+			y->key.rl = x->key.rr;
+			if (y->key.rl) y->key.rl->key.rp = y;
+			x->key.rr = y;
+		} else {
+			y->key.rr = x->key.rl;
+			if (y->key.rr) y->key.rr->key.rp = y;
+			x->key.rl = y;
+		}
+	}
+};
+
+// Instr is an instrumentation policy (instrumentation.h)
+template <class T, bool Evertable = true, class Stat = Statistic, class Alloc = PoolAllocator,
+	class Instr = NoInstrumentation>
 class EulerTree {
 public:
 	class STKey;
@@ -18,7 +113,7 @@ public:
 	class Node;
 	typedef std::reference_wrapper<const Node> NodeRef;
 	typedef SplayNode<STKey, Stat> STNode;
-	typedef SplayTree<STKey, Stat, STNode, FalseComp > ST;
+	typedef SplayTree<STKey, Stat, STNode, FalseComp, Alloc, Instr> ST;
 	typedef STNode* Edge;
 	typedef T ItemType;
 	const bool EVERTABLE = Evertable;
@@ -29,7 +124,9 @@ public:
 		Node (const T& k) : key(k), repr(nullptr) {}
 	};
 
-	struct STKey {
+	typedef OccurRing<STNode, Evertable> Ring;
+
+	struct STKey : Ring {
 		Node *node;
 		STNode *prev;
 		STNode *next;
@@ -37,20 +134,91 @@ public:
 		STKey(Node *k, STNode *p, STNode *n) : node(k), prev(p), next(n) {}
 	};
 
+	static const size_t NO_PARENT = (size_t)-1;
+
 	EulerTree() : size(0) {}
+	EulerTree(const EulerTree &) = delete;
+	// Nodes still held go away with the pools
+	~EulerTree() { Instr::Freed(nodes.Size() * sizeof(Node) + occurs.Size() * sizeof(STNode)); }
 
 	Node* Add(const T& u) {
-		Node *node = new Node(u);
-		STNode *st_node = ST::CreateNode(STKey(node));
+		Node *node = nodes.Create(u);
+		Instr::Allocated(sizeof(Node));
+		STNode *st_node = ST::CreateNode(occurs, STKey(node));
+		Instr::OccurrenceCreated();
 		node->repr = st_node;
 		st_node->key.prev = st_node->key.next = st_node;
-		nodes.insert(node);
+		ST::Update(st_node); // Statistics may look at the representative
 		++size;
 		return node;
 	}
 
+	// Build a forest in linear time.
+	// Vertex i gets keys[i] and parents[i] as its parent (NO_PARENT for roots).
+	// The Euler tour of each tree is laid out by one DFS and turned into
+	// a balanced splay tree directly. If edges is given, (*edges)[i] is
+	// the edge to the parent of vertex i (nullptr for roots).
+	std::vector<Node*> BuildFromParents(const std::vector<T>& keys,
+			const std::vector<size_t>& parents, std::vector<Edge> *edges = nullptr) {
+		assert(keys.size() == parents.size());
+		size_t n = keys.size();
+		std::vector<Node*> vs(n);
+		nodes.Reserve(n);
+		occurs.Reserve(2 * n);
+		for (size_t i = 0 ; i < n ; ++i) vs[i] = nodes.Create(keys[i]);
+		Instr::Allocated(n * sizeof(Node));
+		if (edges) edges->assign(n, nullptr);
+
+		// Children lists in one array
+		std::vector<size_t> first(n + 1, 0), child(n), roots;
+		for (size_t i = 0 ; i < n ; ++i) {
+			if (parents[i] == NO_PARENT) roots.push_back(i);
+			else assert(parents[i] < n), ++first[parents[i] + 1];
+		}
+		for (size_t i = 0 ; i < n ; ++i) first[i + 1] += first[i];
+		std::vector<size_t> fill(first.begin(), first.end() - 1);
+		for (size_t i = 0 ; i < n ; ++i)
+			if (parents[i] != NO_PARENT) child[fill[parents[i]]++] = i;
+
+		// Visit vertex, then each child followed by the vertex again
+		std::vector<STNode *> tour;
+		std::vector<std::pair<size_t, size_t> > stack;
+		size_t visited = 0;
+		for (size_t r = 0 ; r < roots.size() ; ++r) {
+			tour.clear();
+			stack.push_back(std::make_pair(roots[r], first[roots[r]]));
+			tour.push_back(vs[roots[r]]->repr = NewOccur(vs[roots[r]], nullptr));
+			while (!stack.empty()) {
+				size_t v = stack.back().first, &c = stack.back().second;
+				if (c == first[v + 1]) {
+					stack.pop_back();
+					if (!stack.empty()) {
+						Node *p = vs[stack.back().first];
+						tour.push_back(NewOccur(p, LastOccur(p)));
+					}
+					continue;
+				}
+				size_t u = child[c++];
+				if (edges) (*edges)[u] = LastOccur(vs[v]);
+				tour.push_back(vs[u]->repr = NewOccur(vs[u], nullptr));
+				stack.push_back(std::make_pair(u, first[u]));
+			}
+			visited += (tour.size() + 1) / 2;
+			ST::BuildBalanced(tour.data(), tour.data() + tour.size());
+		}
+		assert(visited == n); // no cycle
+		size += n;
+		return vs;
+	}
+
+	// The caller makes sure that u has no connection left
 	void Remove(Node *u) {
-		nodes.erase(u);
+		assert(u->repr->key.next == u->repr);
+		assert(!u->repr->Parent() && !u->repr->Left() && !u->repr->Right());
+		ST::DestroyNode(occurs, u->repr);
+		Instr::OccurrenceDropped();
+		Instr::Freed(sizeof(Node));
+		nodes.Destroy(u);
 		--size;
 	}
 
@@ -107,11 +275,11 @@ public:
 		ST::SplayNode(end);
 		CutChild<true>(end);
 		LinkChild<true>(begin, end);
+		// Dropping begin hands its vertex over to end when begin was the
+		// representative, so end is recomputed after it
 		Compress(begin);
 		// Fix representatives
-		if (Evertable) repr->key.node->repr = repr;
-		// This should be done before compress for statistic
-		if (end->key.node->repr == begin) end->key.node->repr = end;
+		if (Evertable) SetRepr(repr->key.node, repr);
 		ST::Update(end);
 	}
 
@@ -154,31 +322,33 @@ public:
 		assert(!ST::Succ(u->repr->key.prev));
 	}
 
+	// Climb from the vertex whose first occurrence comes first until
+	// the subtree [first, last occurrence] holds the other one.
+	// O(distance to the LCA) probes of O(log n) amortized each and no
+	// allocation, so still linear in the depth.
+	// TODO: O(log n) amortized. A depth aggregate for one range minimum
+	// (as LCAEulerTree keeps) needs the up and down direction of each
+	// tour step, and Evert and Link turn those along a whole path.
 	Node* FindLCA(Node *u, Node *v) {
-		// Very naive algorithm
-		std::vector<STNode *> path;
-		STNode *p = u->repr;
-		while (p) {
-			p = FindFirstOccur(p->key.node);
-			path.push_back(p);
-			p = ST::Pred(p);
+		if (u == v) return u;
+		if (FindRoot(u) != FindRoot(v)) return nullptr;
+		STNode *fu = FindFirstOccur(u), *fv = FindFirstOccur(v);
+		if (!ST::InOrder(fu, fv)) std::swap(fu, fv);
+		while (true) {
+			// The ring goes from the last occurrence back to the first
+			STNode *last = fu->key.prev;
+			if (!ST::InOrder(last, fv)) return fu->key.node;
+			fu = FindFirstOccur(ST::Succ(last)->key.node);
 		}
-		p = v->repr;
-		while (p) {
-			p = FindFirstOccur(p->key.node);
-			for (int i = 0 ; i < path.size() ; ++i) {
-				if (p == path[i]) return p->key.node;
-			}
-			p = ST::Pred(p);
-		}  
-		return nullptr;
 	}
 
+	// Evertable, the vertex before the first occurrence of u: O(log degree)
+	// ring probes of O(log n) amortized each, so O(log deg * log n). Evert
+	// moves the first occurrence of every vertex on the path it turns, so
+	// it is not tracked for an O(log n) lookup.
 	Node* Parent(Node *u) {
 		if (Evertable) {
-			// It's just linear search
-			STNode *cur = u->repr;
-			cur = FindFirstOccur(cur->key.node);
+			STNode *cur = FindFirstOccur(u);
 			STNode *prev = ST::Pred(cur);
 			if (!prev) return nullptr;
 			return prev->key.node;
@@ -190,6 +360,19 @@ public:
 		return nullptr;
 	}
 
+	// Statistic over the subtree of u, i.e. from its first occurrence to
+	// its last one. With SubtreeSumStatistic every vertex counts once.
+	Stat SubtreeStatistic(Node *u) {
+		STNode *first = FindFirstOccur(u);
+		return ST::RangeStatistic(first, first->key.prev);
+	}
+
+	// Recompute statistics after the key of u changed
+	void UpdateKey(Node *u) {
+		ST::SplayNode(u->repr);
+		ST::Update(u->repr);
+	}
+
 	Node* FindRoot(Node *u) {
 		STNode *cur = u->repr;
 		ST::SplayNode(cur);
@@ -203,30 +386,204 @@ public:
 		return Parent(u) == nullptr;
 	}
 
+	// Read-only snapshot for query phases, see FrozenForest.
+	// Vertex i of the snapshot is vertices[i], which has to hold every
+	// parent too. PathStat is built from the keys along root paths.
+	template <class PathStat = Statistic>
+	FrozenForest<T, PathStat> Freeze(const std::vector<Node*>& vertices) {
+		typedef typename FrozenForest<T, PathStat>::Vertex Vertex;
+		std::unordered_map<Node*, Vertex> index;
+		for (size_t i = 0 ; i < vertices.size() ; ++i) index[vertices[i]] = i;
+		std::vector<T> keys;
+		std::vector<Vertex> parents;
+		keys.reserve(vertices.size()), parents.reserve(vertices.size());
+		for (size_t i = 0 ; i < vertices.size() ; ++i) {
+			Node *p = Parent(vertices[i]);
+			assert(!p || index.count(p));
+			parents.push_back(p?index[p]:FrozenForest<T, PathStat>::NONE);
+			keys.push_back(vertices[i]->key);
+		}
+		return FrozenForest<T, PathStat>(keys, parents);
+	}
+
+	// Records of a snapshot file, links are indices. The occurrences of a
+	// vertex are stored from first on in ring order, the first one is
+	// its representative. Statistics are not stored but recomputed.
+	struct SnapshotVertex {
+		T key;
+		uint32_t first;
+	};
+
+	struct SnapshotOccur {
+		uint32_t parent, left, right; // NONE for none
+	};
+
+	// Tagged by their fields, the pool and instrumentation do not matter
+	static uint64_t VertexTag() { return SnapshotTag<T, uint32_t>(); }
+	static uint64_t OccurTag() { return SnapshotTag<uint32_t, uint32_t, uint32_t>(); }
+
+	// Writes the forest to a snapshot file (forest_snapshot.h): the
+	// Freeze() of vertices, which has to hold every vertex, for queries
+	// straight from the mapped file, then the vertices and the occurrence
+	// rings with the shape of the tour splay trees.
+	template <class PathStat = Statistic>
+	bool Save(const std::string& path, const std::vector<Node*>& vertices, std::string *error = nullptr) {
+		typedef FrozenForest<T, PathStat> Frozen;
+		assert(vertices.size() == size);
+		Frozen frozen = Freeze<PathStat>(vertices);
+		std::unordered_map<const STNode*, uint32_t> index;
+		std::vector<SnapshotVertex> vs(vertices.size());
+		memset(static_cast<void *>(vs.data()), 0, vs.size() * sizeof(SnapshotVertex));
+		std::vector<const STNode*> order;
+		for (size_t i = 0 ; i < vertices.size() ; ++i) {
+			vs[i].key = vertices[i]->key, vs[i].first = order.size();
+			const STNode *o = vertices[i]->repr;
+			do index[o] = order.size(), order.push_back(o), o = o->key.next;
+			while (o != vertices[i]->repr);
+		}
+		std::vector<SnapshotOccur> occurs(order.size());
+		for (size_t i = 0 ; i < order.size() ; ++i) {
+			const STNode *o = order[i];
+			occurs[i].parent = o->Parent()?index.at(o->Parent()):Frozen::NONE;
+			occurs[i].left = o->Left()?index.at(o->Left()):Frozen::NONE;
+			occurs[i].right = o->Right()?index.at(o->Right()):Frozen::NONE;
+		}
+		SnapshotWriter writer(SnapshotHeader::EULER_TREE, Evertable?SnapshotHeader::EVERTABLE:0);
+		frozen.Write(writer);
+		writer.Add(vs.data(), vs.size(), VertexTag());
+		writer.Add(occurs.data(), occurs.size(), OccurTag());
+		return writer.Write(path, error);
+	}
+
+	// Adds the forest of a file written by Save(), vertices gets its nodes
+	// in the order given to Save() and, if edges is given, (*edges)[i] the
+	// edge to the parent of vertex i (nullptr for roots). Nodes and
+	// occurrences come from reserved runs of the pools, links are set by
+	// index and statistics recomputed bottom up. False, with nothing
+	// added, if the file holds no Euler tour tree of this type.
+	bool Load(const ForestSnapshot& snapshot, std::vector<Node*>& vertices, std::vector<Edge> *edges = nullptr) {
+		const uint32_t NONE = FrozenForest<T, Statistic>::NONE;
+		const size_t S = FrozenForest<T, Statistic>::SECTIONS;
+		size_t n = 0, m = 0;
+		const SnapshotVertex *vs = snapshot.Section<SnapshotVertex>(S, n, VertexTag());
+		const SnapshotOccur *os = snapshot.Section<SnapshotOccur>(S + 1, m, OccurTag());
+		if (!snapshot.Is(SnapshotHeader::EULER_TREE) || !vs || !os) return false;
+		if (snapshot.Flag(SnapshotHeader::EVERTABLE) != Evertable) return false;
+		if (n?vs[0].first != 0:m != 0) return false;
+		for (size_t i = 0 ; i < n ; ++i)
+			if (vs[i].first >= (i + 1 < n?vs[i + 1].first:m)) return false;
+		// Tour splay trees, parents before children
+		std::vector<uint32_t> order;
+		order.reserve(m);
+		for (size_t i = 0 ; i < m ; ++i)
+			if (os[i].parent == NONE) order.push_back(i);
+		for (size_t i = 0 ; i < order.size() ; ++i) {
+			const SnapshotOccur &o = os[order[i]];
+			if (o.left != NONE && (o.left >= m || os[o.left].parent != order[i])) return false;
+			if (o.right != NONE && (o.right >= m || os[o.right].parent != order[i])) return false;
+			if (o.left != NONE) order.push_back(o.left);
+			if (o.right != NONE) order.push_back(o.right);
+		}
+		if (order.size() != m) return false;
+
+		nodes.Reserve(n);
+		occurs.Reserve(m);
+		vertices.resize(n);
+		std::vector<STNode*> occur(m);
+		for (size_t i = 0 ; i < n ; ++i) {
+			Node *u = vertices[i] = nodes.Create(vs[i].key);
+			Instr::Allocated(sizeof(Node));
+			size_t end = (i + 1 < n)?vs[i + 1].first:m;
+			for (size_t k = vs[i].first ; k < end ; ++k)
+				occur[k] = NewOccur(u, k == vs[i].first?nullptr:occur[k - 1]);
+			u->repr = occur[vs[i].first];
+		}
+		for (size_t k = 0 ; k < m ; ++k) {
+			STNode *o = occur[k];
+			o->Parent() = (os[k].parent == NONE)?nullptr:occur[os[k].parent];
+			o->Left() = (os[k].left == NONE)?nullptr:occur[os[k].left];
+			o->Right() = (os[k].right == NONE)?nullptr:occur[os[k].right];
+		}
+		for (size_t k = m ; k --> 0 ;) ST::Update(occur[order[k]]);
+		size += n;
+		if (edges) {
+			edges->assign(n, nullptr);
+			for (size_t i = 0 ; i < n ; ++i) (*edges)[i] = ST::Pred(FindFirstOccur(vertices[i]));
+		}
+		return true;
+	}
+
 	size_t Size() {
 		return size;
 	}
 
+	// Counters of the instrumentation policy
+	static InstrumentationStats Stats() {
+		return Instr::Stats();
+	}
+
 private:
 	void DropOccur(STNode *node) {
 		assert(node->key.prev && node->key.next);
 		node->key.prev->key.next = node->key.next;
 		node->key.next->key.prev = node->key.prev;
+		Ring::Erase(node);
 		if (node == node->key.node->repr) {
 			assert(node->key.next->key.node == node->key.node);
 			node->key.node->repr = node->key.next;
 		}
 		assert(node != node->key.node->repr);
-		node->Left() = node->Right() = nullptr;
-		delete node;
+		FreeOccur(node);
+	}
+
+	STNode *AllocOccur(Node *u) {
+		Instr::OccurrenceCreated();
+		return ST::CreateNode(occurs, STKey(u));
+	}
+
+	void FreeOccur(STNode *occur) {
+		Instr::OccurrenceDropped();
+		ST::DestroyNode(occurs, occur);
+	}
+
+	// Occurrence appended to the ring of u after last (a new ring if null).
+	// Unlike CreateOccur it is not linked into any splay tree
+	STNode *NewOccur(Node *u, STNode *last) {
+		STNode *occur = occurs.Create(STKey(u));
+		Instr::OccurrenceCreated(), Instr::Allocated(sizeof(STNode));
+		occur->stat.Add();
+		if (!last) {
+			occur->key.prev = occur->key.next = occur;
+			return occur;
+		}
+		occur->key.prev = last;
+		occur->key.next = last->key.next;
+		last->key.next->key.prev = occur;
+		last->key.next = occur;
+		Ring::InsertAfter(last, occur);
+		return occur;
+	}
+
+	// Statistics of both occurrences change when the representative moves
+	void SetRepr(Node *u, STNode *occur) {
+		STNode *old = u->repr;
+		if (old == occur) return;
+		u->repr = occur;
+		ST::SplayNode(old), ST::Update(old);
+		ST::SplayNode(occur), ST::Update(occur);
+	}
+
+	STNode *LastOccur(Node *u) {
+		return u->repr->key.prev;
 	}
 
 	STNode *CreateOccur(STNode *last) {
-		STNode *occur = ST::CreateNode(last->key.node);
+		STNode *occur = AllocOccur(last->key.node);
 		occur->key.prev = last;
 		occur->key.next = last->key.next;
 		last->key.next->key.prev = occur;
 		last->key.next = occur;
+		Ring::InsertAfter(last, occur);
 		return occur;
 	}
 
@@ -282,27 +639,27 @@ private:
 		assert(!child || child->Parent() == parent);
 	}
 
-	// This function is very bad if it is evertable
+	// O(log n) amortized splays per probe of the ring, O(log degree) probes
 	STNode* FindFirstOccur(Node *u) {
 		if (!Evertable) return u->repr;
-		STNode *cur = u->repr;
-		while (cur->key.prev != cur) {
-			ST::SplayNode(cur);
-			STNode *prev = cur->key.prev;
-			while (prev->Parent() != cur) prev = prev->Parent();
-			if (prev == cur->Right()) break;
-			cur = cur->key.prev;
-		}
-		ST::SplayNode(cur);
-		return cur;
+		return Ring::template First<ST>(u->repr);
 	}
 
 
 	size_t size;
-	std::unordered_set<Node *> nodes;
+	typename Alloc::template Pool<Node> nodes;
+	typename Alloc::template Pool<STNode> occurs;
 
 };
 
+template <class T, bool Evertable, class Stat, class Alloc, class Instr>
+const size_t EulerTree<T, Evertable, Stat, Alloc, Instr>::NO_PARENT;
+
+class LCAStatistic;
+
+template <>
+struct IsAddressStatistic<LCAStatistic> { enum { value = true }; };
+
 class LCAStatistic : public Statistic {
 public:
 	void *key;
@@ -372,10 +729,41 @@ public:
 
 };
 
-template <class T>
-class LCAEulerTree : public EulerTree<T, false, LCAStatistic> {
+// Sum of vertex keys and number of vertices.
+// Only the representative occurrence of a vertex carries its key, so a
+// range of the tour counts every vertex in it once.
+template <typename T>
+class SubtreeSumStatistic : public Statistic {
+public:
+	size_t size;
+	T sum;
+	SubtreeSumStatistic() : Statistic(), size(0), sum() {}
+
+	template <typename Key>
+	void Init(const Key& key) {
+		bool repr = key.node->repr && &(key.node->repr->key) == &key;
+		size = repr;
+		sum = repr?key.node->key:T();
+	}
+
+	void UpdateLeft(const SubtreeSumStatistic& s) {
+		Update(s);
+	}
+
+	void UpdateRight(const SubtreeSumStatistic& s) {
+		Update(s);
+	}
+
+	void Update(const SubtreeSumStatistic& s) {
+		size += s.size;
+		sum += s.sum;
+	}
+};
+
+template <class T, class Alloc = PoolAllocator, class Instr = NoInstrumentation>
+class LCAEulerTree : public EulerTree<T, false, LCAStatistic, Alloc, Instr> {
 	public:
-	typedef EulerTree<T, false, LCAStatistic> ET;
+	typedef EulerTree<T, false, LCAStatistic, Alloc, Instr> ET;
 	typedef typename ET::NodeRef NodeRef;
 	typedef LCAStatistic Stat;
 	typedef typename ET::STNode STNode;
@@ -120,6 +120,167 @@ void NonEvertableETSimpleTest(size_t n) {
 
 	std::cout << "Non Evertable Simple Test Done" << std::endl;
 }
+// Parent, LCA and subtree sums after everts, cuts and links
+// around a high degree vertex
+template <bool Evertable>
+void DynamicQueryTest(size_t n) {
+	typedef EulerTree<size_t, Evertable, SubtreeSumStatistic<size_t> > Tree_t;
+	typedef typename Tree_t::Node Node;
+	typedef typename Tree_t::Edge Edge;
+
+	Tree_t Tree;
+	std::vector<Node *> nodes;
+	std::vector<Edge> edges(n);
+	std::vector<size_t> lp(n, n); // the parent given to Link
+	for (size_t i = 0 ; i < n ; ++i) nodes.push_back(Tree.Add(i));
+	for (size_t i = 1 ; i < n ; ++i) {
+		lp[i] = (i % 2)?0:rand() % i;
+		edges[i] = Tree.Link(nodes[i], nodes[lp[i]]);
+	}
+
+	// Parents of the tree of v rooted at r by a plain search
+	std::vector<std::vector<size_t> > adj(n);
+	std::vector<size_t> par(n), queue;
+	auto search = [&](size_t r) {
+		for (size_t i = 0 ; i < n ; ++i) adj[i].clear(), par[i] = n + 1;
+		for (size_t i = 0 ; i < n ; ++i)
+			if (lp[i] != n) adj[i].push_back(lp[i]), adj[lp[i]].push_back(i);
+		queue.assign(1, r);
+		par[r] = n;
+		for (size_t k = 0 ; k < queue.size() ; ++k)
+			for (size_t j = 0 ; j < adj[queue[k]].size() ; ++j) {
+				size_t w = adj[queue[k]][j];
+				if (par[w] == n + 1) par[w] = queue[k], queue.push_back(w);
+			}
+	};
+
+	for (size_t it = 0 ; it < 2 * n ; ++it) {
+		size_t v = rand() % n;
+		switch (rand() % 3) {
+			case 0:
+				if (Evertable) Tree.Evert(nodes[v]);
+				break;
+			case 1: {
+				if (lp[v] == n) break;
+				size_t w = rand() % n;
+				Tree.Cut(edges[v]);
+				lp[v] = n;
+				search(v);
+				if (par[w] != n + 1) w = rand() % 2?0:n; // same side, try the hub
+				if (w == n || par[w] != n + 1) break;
+				if (Evertable) Tree.Evert(nodes[v]);
+				edges[v] = Tree.Link(nodes[v], nodes[w]);
+				lp[v] = w;
+				break;
+			}
+			default: {
+				size_t r = Tree.FindRoot(nodes[v])->key;
+				search(r);
+				Node *p = Tree.Parent(nodes[v]);
+				if (par[v] == n) assert(!p);
+				else assert(p == nodes[par[v]]);
+				// Subtree of v: vertices whose path to the root passes v
+				size_t size = 0, sum = 0;
+				for (size_t x = 0 ; x < n ; ++x) {
+					size_t y = x;
+					if (par[y] == n + 1) continue;
+					while (y != n && y != v) y = par[y];
+					if (y == v) ++size, sum += x;
+				}
+				SubtreeSumStatistic<size_t> stat = Tree.SubtreeStatistic(nodes[v]);
+				assert(stat.size == size && stat.sum == sum);
+				size_t w = rand() % n;
+				if (par[w] == n + 1) {
+					assert(!Tree.FindLCA(nodes[v], nodes[w]));
+					break;
+				}
+				// Mark the ancestors of v, the first marked one above w is the LCA
+				std::vector<bool> up(n, false);
+				for (size_t x = v ; x != n ; x = par[x]) up[x] = true;
+				size_t lca = w;
+				while (!up[lca]) lca = par[lca];
+				assert(Tree.FindLCA(nodes[v], nodes[w]) == nodes[lca]);
+			}
+		}
+	}
+
+	std::cout << "Dynamic Query Test Done" << std::endl;
+}
+
+template <class EulerTree>
+void BuildTest(size_t n) {
+	typedef typename EulerTree::Node Node;
+	typedef typename EulerTree::Edge Edge;
+
+	// A random forest given as a parent array in shuffled order
+	std::vector<size_t> keys(n), par(n, EulerTree::NO_PARENT), perm(n);
+	for (size_t i = 0 ; i < n ; ++i) keys[i] = perm[i] = i;
+	for (size_t i = n - 1 ; i > 0 ; --i) std::swap(perm[i], perm[rand() % (i + 1)]);
+	for (size_t i = 1 ; i < n ; ++i)
+		if (rand() % 50) par[perm[i]] = perm[rand() % i];
+
+	EulerTree Tree;
+	std::vector<Edge> edges;
+	std::vector<Node *> nodes = Tree.BuildFromParents(keys, par, &edges);
+	assert(Tree.Size() == n);
+
+	for (size_t i = 0 ; i < n ; ++i) {
+		size_t r = i;
+		while (par[r] != EulerTree::NO_PARENT) r = par[r];
+		assert(Tree.FindRoot(nodes[i]) == nodes[r]);
+		Node *p = Tree.Parent(nodes[i]);
+		if (par[i] == EulerTree::NO_PARENT) assert(!p && !edges[i]);
+		else assert(p == nodes[par[i]] && edges[i]->key.node == p);
+	}
+
+	// Returned edges can be cut like the ones from Link
+	for (size_t i = 1 ; i < n ; ++i) {
+		size_t v = perm[i];
+		if (!edges[v]) continue;
+		Tree.Cut(edges[v]);
+		assert(Tree.FindRoot(nodes[v]) == nodes[v]);
+		edges[v] = Tree.Link(nodes[v], nodes[perm[0]]);
+		assert(Tree.Parent(nodes[v]) == nodes[perm[0]]);
+	}
+
+	std::cout << "Build Test Done" << std::endl;
+}
+
+template <bool Evertable>
+void FreezeTest(size_t n) {
+	typedef EulerTree<size_t, Evertable> Tree;
+	typedef typename Tree::Node Node;
+	typedef FrozenForest<size_t, SumStatistic<size_t> > Frozen;
+
+	Tree tree;
+	std::vector<Node *> nodes;
+	std::vector<size_t> par(n, Frozen::NONE);
+	for (size_t i = 0 ; i < n ; ++i) nodes.push_back(tree.Add(i));
+	for (size_t i = 1 ; i < n ; ++i)
+		if (rand() % 20) tree.Link(nodes[i], nodes[par[i] = rand() % i]);
+	if (Evertable)
+		for (size_t i = 0 ; i < n / 10 ; ++i) tree.Evert(nodes[rand() % n]);
+
+	const Frozen frozen = tree.template Freeze<SumStatistic<size_t> >(nodes);
+	for (size_t i = 0 ; i < n ; ++i) {
+		Node *p = tree.Parent(nodes[i]);
+		assert(p?nodes[frozen.Parent(i)] == p:frozen.IsRoot(i));
+		assert(nodes[frozen.FindRoot(i)] == tree.FindRoot(nodes[i]));
+		assert(frozen.Key(i) == i);
+		// Root path sums by walking up
+		size_t sum = 0, depth = 0;
+		for (Node *v = nodes[i] ; v ; v = tree.Parent(v)) sum += v->key, ++depth;
+		assert(frozen.Path(i).sum == sum && frozen.Depth(i) == depth - 1);
+		if (!Evertable) assert(frozen.Parent(i) == par[i]);
+
+		size_t a = rand() % n, b = rand() % n;
+		Node *lca = tree.FindLCA(nodes[a], nodes[b]);
+		assert(lca?nodes[frozen.FindLCA(a, b)] == lca:frozen.FindLCA(a, b) == Frozen::NONE);
+	}
+
+	std::cout << "Freeze Test Done" << std::endl;
+}
+
 int main(int argc, const char *argv[])
 {
 	srand(time(NULL));
@@ -128,5 +289,12 @@ int main(int argc, const char *argv[])
 	LCATest<ET>(10000);
 	LCATest<ET2>(10000);
 	LCATest<ET3>(100000);
+	BuildTest<ET>(2000);
+	DynamicQueryTest<true>(2000);
+	DynamicQueryTest<false>(2000);
+	BuildTest<ET2>(10000);
+	BuildTest<ET3>(10000);
+	FreezeTest<true>(2000);
+	FreezeTest<false>(2000);
 	return 0;
 }
@@ -0,0 +1,289 @@
+#ifndef __FOREST_SNAPSHOT_H__
+#define __FOREST_SNAPSHOT_H__
+
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <vector>
+#include <memory>
+#include <type_traits>
+#include <typeinfo>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// Snapshot files of LinkCutTree and EulerTree forests.
+//
+// A file is a fixed header followed by sections, each an array of
+// trivially copyable records aligned to 64 bytes. Records refer to each
+// other by index, never by address, so a file opened with mmap is used
+// in place: FrozenForest::Map() answers queries straight from the mapped
+// pages, with no allocation or fixup per vertex. LinkCutTree::Load() and
+// EulerTree::Load() restore a live forest from the same file.
+//
+// Sections 0 to 5 always hold a FrozenForest, the structure specific
+// records follow. The layout is that of the writing machine: the header
+// records the byte order, and each section the size and a tag of the
+// types of its records (SnapshotTag), so files from another version,
+// byte order or instantiation are refused. Statistics holding addresses
+// (IsAddressStatistic) cannot be stored at all.
+//
+// checksum is a 64-bit hash of the file past the checksum field.
+
+static const uint32_t SNAPSHOT_VERSION = 2;
+
+struct SnapshotSection {
+	uint64_t offset; // from the start of the file
+	uint64_t count; // records
+	uint64_t record_size;
+	uint64_t tag; // SnapshotTag of the record types
+};
+
+struct SnapshotHeader {
+	enum { MAX_SECTIONS = 8 };
+	enum Kind { LINK_CUT_TREE = 1, EULER_TREE = 2 };
+	enum Flag { EVERTABLE = 1, TAGGED = 2 };
+	char magic[8];
+	uint32_t version;
+	uint32_t byte_order;
+	uint64_t checksum;
+	uint64_t bytes; // whole file
+	uint32_t kind;
+	uint32_t flags;
+	uint32_t sections;
+	uint32_t reserved;
+	SnapshotSection section[MAX_SECTIONS];
+
+	static const char *Magic() {
+		return "DYNTREE";
+	}
+	static uint32_t ByteOrder() {
+		return 0x01020304u;
+	}
+};
+
+// 64-bit multiplicative hash over 8-byte words, bytes of an unfinished
+// word are carried into the next Update
+class SnapshotChecksum {
+public:
+	SnapshotChecksum() : hash(14695981039346656037ull), carry(0), carried(0) {}
+
+	void Update(const void *data, size_t bytes) {
+		const unsigned char *p = static_cast<const unsigned char *>(data);
+		while (carried && bytes) Carry(*p++), --bytes;
+		for (; bytes >= 8 ; p += 8, bytes -= 8) {
+			uint64_t word;
+			memcpy(&word, p, 8);
+			Mix(word);
+		}
+		while (bytes--) Carry(*p++);
+	}
+
+	uint64_t Value() const {
+		uint64_t h = hash;
+		if (carried) h = (h ^ carry ^ carried) * PRIME;
+		return h ^ (h >> 29);
+	}
+
+private:
+	static const uint64_t PRIME = 1099511628211ull;
+
+	void Mix(uint64_t word) {
+		hash = (hash ^ word) * PRIME;
+		hash ^= hash >> 32;
+	}
+
+	void Carry(unsigned char c) {
+		carry |= uint64_t(c) << (8 * carried);
+		if (++carried == 8) Mix(carry), carry = 0, carried = 0;
+	}
+
+	uint64_t hash, carry;
+	size_t carried;
+};
+
+// Tag of the types R..., a hash of their names. The names are those the
+// compiler gives, so files move between builds of one toolchain
+template <class... R>
+uint64_t SnapshotTag() {
+	const char *names[] = { typeid(R).name()... };
+	SnapshotChecksum sum;
+	for (size_t i = 0 ; i < sizeof...(R) ; ++i) sum.Update(names[i], strlen(names[i]) + 1);
+	return sum.Value();
+}
+
+// Collects sections and writes them out. Records are not copied, they
+// have to stay alive until Write().
+class SnapshotWriter {
+public:
+	SnapshotWriter(uint32_t kind, uint32_t flags) : kind(kind), flags(flags) {}
+
+	// tag tells the types of the records, R itself unless given
+	template <class R>
+	void Add(const R *records, size_t count, uint64_t tag = SnapshotTag<R>()) {
+		static_assert(std::is_trivially_copyable<R>::value, "snapshot records are copied as bytes");
+		assert(parts.size() < SnapshotHeader::MAX_SECTIONS);
+		Part part = { records, count, sizeof(R), tag };
+		parts.push_back(part);
+	}
+
+	bool Write(const std::string &path, std::string *error = nullptr) const {
+		SnapshotHeader header;
+		memset(&header, 0, sizeof(header));
+		memcpy(header.magic, SnapshotHeader::Magic(), 8);
+		header.version = SNAPSHOT_VERSION;
+		header.byte_order = SnapshotHeader::ByteOrder();
+		header.kind = kind, header.flags = flags;
+		header.sections = parts.size();
+		uint64_t offset = Align(sizeof(header));
+		for (size_t i = 0 ; i < parts.size() ; ++i) {
+			header.section[i].offset = offset;
+			header.section[i].count = parts[i].count;
+			header.section[i].record_size = parts[i].record_size;
+			header.section[i].tag = parts[i].tag;
+			offset = Align(offset + parts[i].count * parts[i].record_size);
+		}
+		header.bytes = offset;
+
+		// Checksum first, then one pass of writes
+		SnapshotChecksum sum;
+		const size_t skip = offsetof(SnapshotHeader, checksum) + sizeof(header.checksum);
+		sum.Update(reinterpret_cast<const char *>(&header) + skip, sizeof(header) - skip);
+		Pad(sum, sizeof(header));
+		for (size_t i = 0 ; i < parts.size() ; ++i)
+			sum.Update(parts[i].data, parts[i].count * parts[i].record_size), Pad(sum, parts[i].Bytes());
+		header.checksum = sum.Value();
+
+		FILE *file = fopen(path.c_str(), "wb");
+		if (!file) return Fail(error, "cannot open " + path);
+		bool ok = Put(file, &header, sizeof(header));
+		for (size_t i = 0 ; i < parts.size() && ok ; ++i)
+			ok = Put(file, parts[i].data, parts[i].Bytes());
+		ok = (fclose(file) == 0) && ok;
+		return ok || Fail(error, "cannot write " + path);
+	}
+
+private:
+	static const size_t ALIGN = 64;
+
+	struct Part {
+		const void *data;
+		size_t count, record_size;
+		uint64_t tag;
+		size_t Bytes() const { return count * record_size; }
+	};
+
+	static uint64_t Align(uint64_t offset) {
+		return (offset + ALIGN - 1) / ALIGN * ALIGN;
+	}
+
+	static void Pad(SnapshotChecksum &sum, size_t bytes) {
+		static const char zeros[ALIGN] = {};
+		sum.Update(zeros, Align(bytes) - bytes);
+	}
+
+	// Data followed by zeros up to the next section
+	static bool Put(FILE *file, const void *data, size_t bytes) {
+		static const char zeros[ALIGN] = {};
+		size_t pad = Align(bytes) - bytes;
+		return fwrite(data, 1, bytes, file) == bytes && fwrite(zeros, 1, pad, file) == pad;
+	}
+
+	static bool Fail(std::string *error, const std::string &message) {
+		if (error) *error = message;
+		return false;
+	}
+
+	uint32_t kind, flags;
+	std::vector<Part> parts;
+};
+
+// A snapshot file mapped read only. Open() checks the header and, unless
+// told not to, the checksum; the pages are touched only by the checksum
+// and later by the queries. Share it through the shared_ptr, the mapping
+// lives as long as any FrozenForest mapped on it.
+class ForestSnapshot {
+public:
+	static std::shared_ptr<const ForestSnapshot> Open(const std::string &path,
+			std::string *error = nullptr, bool verify = true) {
+		std::shared_ptr<ForestSnapshot> snapshot(new ForestSnapshot());
+		int fd = open(path.c_str(), O_RDONLY);
+		if (fd < 0) return Fail(error, "cannot open " + path);
+		struct stat st;
+		if (fstat(fd, &st) != 0 || size_t(st.st_size) < sizeof(SnapshotHeader)) {
+			close(fd);
+			return Fail(error, path + " is too short");
+		}
+		void *mem = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+		close(fd);
+		if (mem == MAP_FAILED) return Fail(error, "cannot map " + path);
+		snapshot->base = static_cast<const char *>(mem), snapshot->bytes = st.st_size;
+
+		const SnapshotHeader &h = snapshot->Header();
+		if (memcmp(h.magic, SnapshotHeader::Magic(), 8) != 0) return Fail(error, path + " is not a snapshot");
+		if (h.version != SNAPSHOT_VERSION) return Fail(error, path + " has an unknown version");
+		if (h.byte_order != SnapshotHeader::ByteOrder()) return Fail(error, path + " has another byte order");
+		if (h.bytes != snapshot->bytes || h.sections > SnapshotHeader::MAX_SECTIONS)
+			return Fail(error, path + " is truncated");
+		for (size_t i = 0 ; i < h.sections ; ++i) {
+			const SnapshotSection &s = h.section[i];
+			if (s.offset > h.bytes || (s.record_size && s.count > (h.bytes - s.offset) / s.record_size))
+				return Fail(error, path + " is truncated");
+		}
+		if (verify && snapshot->Checksum() != h.checksum) return Fail(error, path + " fails its checksum");
+		return snapshot;
+	}
+
+	~ForestSnapshot() {
+		if (base) munmap(const_cast<char *>(base), bytes);
+	}
+
+	const SnapshotHeader &Header() const {
+		return *reinterpret_cast<const SnapshotHeader *>(base);
+	}
+
+	bool Is(uint32_t kind) const {
+		return Header().kind == kind;
+	}
+
+	bool Flag(uint32_t flag) const {
+		return Header().flags & flag;
+	}
+
+	// Records of section i, nullptr if there is no such section or its
+	// records are not R (tagged as by SnapshotWriter::Add). count is set
+	// to the number of records.
+	template <class R>
+	const R *Section(size_t i, size_t &count, uint64_t tag = SnapshotTag<R>()) const {
+		const SnapshotHeader &h = Header();
+		if (i >= h.sections || h.section[i].record_size != sizeof(R)) return nullptr;
+		if (h.section[i].tag != tag) return nullptr;
+		count = h.section[i].count;
+		return reinterpret_cast<const R *>(base + h.section[i].offset);
+	}
+
+	uint64_t Checksum() const {
+		SnapshotChecksum sum;
+		const size_t skip = offsetof(SnapshotHeader, checksum) + sizeof(uint64_t);
+		sum.Update(base + skip, bytes - skip);
+		return sum.Value();
+	}
+
+private:
+	ForestSnapshot() : base(nullptr), bytes(0) {}
+	ForestSnapshot(const ForestSnapshot &) = delete;
+
+	static std::shared_ptr<const ForestSnapshot> Fail(std::string *error, const std::string &message) {
+		if (error) *error = message;
+		return nullptr;
+	}
+
+	const char *base;
+	size_t bytes;
+};
+
+#endif /* __FOREST_SNAPSHOT_H__ */
@@ -0,0 +1,182 @@
+#ifndef __FROZEN_FOREST_H__
+#define __FROZEN_FOREST_H__
+
+#include <cassert>
+#include <cstdint>
+#include <vector>
+#include <memory>
+#include <utility>
+
+#include "statistics.h"
+#include "forest_snapshot.h"
+
+// Read-only snapshot of a rooted forest, made by LinkCutTree::Freeze()
+// or EulerTree::Freeze(), or mapped from a snapshot file by Map().
+// Vertices are the indices of the node vector given to Freeze(). Nothing
+// is modified by a query, so any number of threads can share one
+// snapshot, and copies share the arrays.
+//
+// Parents, depths and roots are kept in flat arrays, ancestors by binary
+// lifting: up[k * n + v] is the 2^k-th ancestor of v (v itself past the
+// root). Path(v) is the statistic of the path from the root down to v,
+// combined in the same order as LinkCutTree::Path().
+template <class T, class Stat>
+class FrozenForest {
+public:
+	typedef uint32_t Vertex;
+	static const Vertex NONE = 0xffffffffu;
+	enum { SECTIONS = 6 };
+
+	FrozenForest() : n(0), levels(0), keys(nullptr), parents(nullptr), depths(nullptr),
+		roots(nullptr), up(nullptr), paths(nullptr) {}
+
+	// parents[v] is NONE for roots
+	FrozenForest(const std::vector<T>& key_list, const std::vector<Vertex>& parent_list) {
+		std::shared_ptr<Arrays> a = std::make_shared<Arrays>();
+		a->keys = key_list, a->parents = parent_list;
+		n = a->keys.size();
+		assert(a->keys.size() == a->parents.size() && n < NONE);
+		levels = Levels(n);
+		a->depths.assign(n, 0);
+		a->roots.assign(n, NONE);
+		a->paths.resize(n);
+		a->up.resize(levels * n);
+		std::vector<Vertex> &parents = a->parents, &depths = a->depths, &roots = a->roots, &up = a->up;
+		std::vector<Stat> &paths = a->paths;
+
+		// Parents before children
+		std::vector<Vertex> first(n + 1, 0), order;
+		for (Vertex v = 0 ; v < n ; ++v)
+			if (parents[v] != NONE) assert(parents[v] < n), ++first[parents[v] + 1];
+		for (Vertex v = 0 ; v < n ; ++v) first[v + 1] += first[v];
+		std::vector<Vertex> child(n), fill(first.begin(), first.end() - 1);
+		for (Vertex v = 0 ; v < n ; ++v)
+			if (parents[v] != NONE) child[fill[parents[v]]++] = v;
+		order.reserve(n);
+		for (Vertex v = 0 ; v < n ; ++v)
+			if (parents[v] == NONE) order.push_back(v);
+		for (size_t i = 0 ; i < order.size() ; ++i)
+			for (Vertex c = first[order[i]] ; c < first[order[i] + 1] ; ++c)
+				order.push_back(child[c]);
+		assert(order.size() == n); // no cycle
+
+		for (size_t i = 0 ; i < n ; ++i) {
+			Vertex v = order[i], p = parents[v];
+			paths[v].Init(a->keys[v]);
+			if (p == NONE) {
+				roots[v] = v, up[v] = v;
+			} else {
+				roots[v] = roots[p], depths[v] = depths[p] + 1, up[v] = p;
+				paths[v].UpdateLeft(paths[p]);
+			}
+		}
+		for (size_t k = 1 ; k < levels ; ++k)
+			for (Vertex v = 0 ; v < n ; ++v)
+				up[k * n + v] = up[(k - 1) * n + up[(k - 1) * n + v]];
+
+		this->keys = a->keys.data(), this->parents = parents.data(), this->depths = depths.data();
+		this->roots = roots.data(), this->up = up.data(), this->paths = paths.data();
+		owner = a;
+	}
+
+	// Adds the arrays as sections 0 to 5 of a snapshot
+	void Write(SnapshotWriter& writer) const {
+		static_assert(!IsAddressStatistic<Stat>::value, "statistics holding addresses cannot be stored");
+		writer.Add(keys, n), writer.Add(parents, n), writer.Add(depths, n);
+		writer.Add(roots, n), writer.Add(up, levels * n), writer.Add(paths, n);
+	}
+
+	// Answers from the pages of a snapshot file, in place. False if the
+	// file holds no forest of this T and Stat.
+	bool Map(const std::shared_ptr<const ForestSnapshot>& snapshot) {
+		static_assert(!IsAddressStatistic<Stat>::value, "statistics holding addresses cannot be stored");
+		size_t count[SECTIONS];
+		const T *k = snapshot->Section<T>(0, count[0]);
+		const Vertex *p = snapshot->Section<Vertex>(1, count[1]);
+		const Vertex *d = snapshot->Section<Vertex>(2, count[2]);
+		const Vertex *r = snapshot->Section<Vertex>(3, count[3]);
+		const Vertex *u = snapshot->Section<Vertex>(4, count[4]);
+		const Stat *s = snapshot->Section<Stat>(5, count[5]);
+		if (!k || !p || !d || !r || !u || !s) return false;
+		size_t m = count[0], l = Levels(m);
+		if (count[1] != m || count[2] != m || count[3] != m || count[4] != l * m || count[5] != m) return false;
+		n = m, levels = l;
+		keys = k, parents = p, depths = d, roots = r, up = u, paths = s;
+		owner = snapshot;
+		return true;
+	}
+
+	Vertex FindRoot(Vertex v) const {
+		return roots[v];
+	}
+
+	Vertex Parent(Vertex v) const {
+		return parents[v];
+	}
+
+	bool IsRoot(Vertex v) const {
+		return parents[v] == NONE;
+	}
+
+	size_t Depth(Vertex v) const {
+		return depths[v];
+	}
+
+	// The ancestor d levels above v, NONE if v is not that deep
+	Vertex Ancestor(Vertex v, size_t d) const {
+		if (d > depths[v]) return NONE;
+		for (size_t k = 0 ; d ; ++k, d >>= 1)
+			if (d & 1) v = up[k * n + v];
+		return v;
+	}
+
+	// NONE if v and w are in different trees
+	Vertex FindLCA(Vertex v, Vertex w) const {
+		if (roots[v] != roots[w]) return NONE;
+		if (depths[v] < depths[w]) std::swap(v, w);
+		v = Ancestor(v, depths[v] - depths[w]);
+		if (v == w) return v;
+		for (size_t k = levels ; k --> 0 ;) {
+			Vertex a = up[k * n + v], b = up[k * n + w];
+			if (a != b) v = a, w = b;
+		}
+		return parents[v];
+	}
+
+	const Stat& Path(Vertex v) const {
+		return paths[v];
+	}
+
+	const T& Key(Vertex v) const {
+		return keys[v];
+	}
+
+	size_t Size() const {
+		return n;
+	}
+
+private:
+	struct Arrays {
+		std::vector<T> keys;
+		std::vector<Vertex> parents, depths, roots, up;
+		std::vector<Stat> paths;
+	};
+
+	static size_t Levels(size_t n) {
+		size_t levels = 1;
+		while ((size_t(1) << levels) < n) ++levels;
+		return levels;
+	}
+
+	size_t n, levels;
+	// Into the Arrays or the snapshot held by owner
+	const T *keys;
+	const Vertex *parents, *depths, *roots, *up;
+	const Stat *paths;
+	std::shared_ptr<const void> owner;
+};
+
+template <class T, class Stat>
+const typename FrozenForest<T, Stat>::Vertex FrozenForest<T, Stat>::NONE;
+
+#endif /* __FROZEN_FOREST_H__ */
@@ -0,0 +1,135 @@
+#ifndef __INSTRUMENTATION_H__
+#define __INSTRUMENTATION_H__
+
+#include <cstdint>
+#include <atomic>
+
+// Instrumentation policies for SplayTreeBase, SplayTree, LinkCutTree and
+// EulerTree (template parameter Instr). The trees call the static hooks
+// below from their internals; NoInstrumentation leaves every hook empty
+// so it compiles to nothing.
+
+// Counters read through Stats()
+struct InstrumentationStats {
+	uint64_t rotations;
+	uint64_t splays; // splays that moved a node up
+	uint64_t splay_depth; // summed over splays, depth the node started at
+	uint64_t max_splay_depth;
+	uint64_t accesses; // link cut tree Access calls
+	uint64_t preferred_changes; // preferred child switches, summed over accesses
+	uint64_t max_preferred_changes; // most switches in one Access
+	uint64_t reverse_pushes; // reverse flags pushed down
+	uint64_t occurrences_created; // euler tour occurrences
+	uint64_t occurrences_dropped;
+	int64_t live_bytes; // bytes of the nodes currently held
+
+	InstrumentationStats() : rotations(0), splays(0), splay_depth(0), max_splay_depth(0),
+		accesses(0), preferred_changes(0), max_preferred_changes(0), reverse_pushes(0),
+		occurrences_created(0), occurrences_dropped(0), live_bytes(0) {}
+};
+
+struct NoInstrumentation {
+	enum { ENABLED = false };
+	static void Rotation() {}
+	static void Splay(size_t depth) {}
+	static void Access(size_t preferred_changes) {}
+	static void ReversePush() {}
+	static void OccurrenceCreated() {}
+	static void OccurrenceDropped() {}
+	static void Allocated(size_t bytes) {}
+	static void Freed(size_t bytes) {}
+	static InstrumentationStats Stats() { return InstrumentationStats(); }
+	static void Reset() {}
+};
+
+// Counts everything. Counters are shared by all structures using the
+// same Tag, give a structure its own Tag to see it alone. They are
+// relaxed atomics so that threads sharing a structure can count too.
+template <class Tag = void>
+struct CountingInstrumentation {
+	enum { ENABLED = true };
+
+	static void Rotation() {
+		Inc(counters.rotations);
+	}
+
+	static void Splay(size_t depth) {
+		Inc(counters.splays), Inc(counters.splay_depth, depth);
+		Max(counters.max_splay_depth, depth);
+	}
+
+	static void Access(size_t preferred_changes) {
+		Inc(counters.accesses), Inc(counters.preferred_changes, preferred_changes);
+		Max(counters.max_preferred_changes, preferred_changes);
+	}
+
+	static void ReversePush() {
+		Inc(counters.reverse_pushes);
+	}
+
+	static void OccurrenceCreated() {
+		Inc(counters.occurrences_created);
+	}
+
+	static void OccurrenceDropped() {
+		Inc(counters.occurrences_dropped);
+	}
+
+	static void Allocated(size_t bytes) {
+		counters.live_bytes.fetch_add(bytes, std::memory_order_relaxed);
+	}
+
+	static void Freed(size_t bytes) {
+		counters.live_bytes.fetch_sub(bytes, std::memory_order_relaxed);
+	}
+
+	static InstrumentationStats Stats() {
+		InstrumentationStats s;
+		s.rotations = counters.rotations;
+		s.splays = counters.splays;
+		s.splay_depth = counters.splay_depth;
+		s.max_splay_depth = counters.max_splay_depth;
+		s.accesses = counters.accesses;
+		s.preferred_changes = counters.preferred_changes;
+		s.max_preferred_changes = counters.max_preferred_changes;
+		s.reverse_pushes = counters.reverse_pushes;
+		s.occurrences_created = counters.occurrences_created;
+		s.occurrences_dropped = counters.occurrences_dropped;
+		s.live_bytes = counters.live_bytes;
+		return s;
+	}
+
+	// Live bytes are kept, they still describe the structures
+	static void Reset() {
+		counters.rotations = 0, counters.splays = 0;
+		counters.splay_depth = 0, counters.max_splay_depth = 0;
+		counters.accesses = 0, counters.preferred_changes = 0;
+		counters.max_preferred_changes = 0, counters.reverse_pushes = 0;
+		counters.occurrences_created = 0, counters.occurrences_dropped = 0;
+	}
+
+private:
+	struct Counters {
+		std::atomic<uint64_t> rotations, splays, splay_depth, max_splay_depth;
+		std::atomic<uint64_t> accesses, preferred_changes, max_preferred_changes;
+		std::atomic<uint64_t> reverse_pushes, occurrences_created, occurrences_dropped;
+		std::atomic<int64_t> live_bytes;
+	};
+
+	static void Inc(std::atomic<uint64_t> &c, uint64_t d = 1) {
+		c.fetch_add(d, std::memory_order_relaxed);
+	}
+
+	static void Max(std::atomic<uint64_t> &c, uint64_t v) {
+		uint64_t old = c.load(std::memory_order_relaxed);
+		while (old < v && !c.compare_exchange_weak(old, v, std::memory_order_relaxed));
+	}
+
+	static Counters counters;
+};
+
+// Zero initialized as a static
+template <class Tag>
+typename CountingInstrumentation<Tag>::Counters CountingInstrumentation<Tag>::counters;
+
+#endif /* __INSTRUMENTATION_H__ */
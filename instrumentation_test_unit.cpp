@@ -0,0 +1,112 @@
+#include <iostream>
+#include <vector>
+#include <cstdlib>
+#include <cassert>
+
+#include "instrumentation.h"
+#include "statistics.h"
+#include "splay_tree.h"
+#include "link_cut_tree.h"
+#include "euler_tree.h"
+
+using namespace std;
+
+struct SplayTag {};
+struct LCTTag {};
+struct ETTag {};
+
+void no_instrumentation_test() {
+	LinkCutTree<size_t, SumStatistic<size_t> > lct;
+	vector<LinkCutTree<size_t, SumStatistic<size_t> >::Node *> nodes;
+	for (size_t i = 0 ; i < 100 ; ++i) nodes.push_back(lct.Add(i));
+	for (size_t i = 1 ; i < 100 ; ++i) lct.Link(nodes[i], nodes[i - 1]);
+	InstrumentationStats s = lct.Stats();
+	assert(s.rotations == 0 && s.accesses == 0 && s.live_bytes == 0);
+	std::cout << "No instrumentation test Done" << std::endl;
+}
+
+void splay_tree_counting_test(size_t N) {
+	typedef CountingInstrumentation<SplayTag> Instr;
+	typedef SplayNode<size_t, SubtreeSizeStatistic> Node;
+	{
+		SplayTree<size_t, SubtreeSizeStatistic, Node, std::less<size_t>, PoolAllocator, Instr> st;
+		vector<size_t> keys;
+		for (size_t i = 0 ; i < N ; ++i) keys.push_back(rand() % N), st.Insert(keys.back());
+		InstrumentationStats s = st.Stats();
+		assert(s.live_bytes > 0 && s.live_bytes <= int64_t(N * sizeof(Node)));
+		assert(s.rotations > 0 && s.splays > 0 && s.max_splay_depth > 0);
+		assert(s.splay_depth == s.rotations && s.max_splay_depth <= s.splay_depth);
+
+		Instr::Reset();
+		assert(Instr::Stats().rotations == 0 && Instr::Stats().live_bytes == s.live_bytes);
+		for (size_t i = 0 ; i < N / 2 ; ++i) st.Erase(keys[i]);
+		assert(Instr::Stats().live_bytes < s.live_bytes);
+	}
+	// The rest is released with the tree
+	assert(Instr::Stats().live_bytes == 0);
+	std::cout << "Splay tree counting test Done" << std::endl;
+}
+
+void link_cut_tree_counting_test(size_t N) {
+	typedef CountingInstrumentation<LCTTag> Instr;
+	typedef LinkCutTree<size_t, SumStatistic<size_t>, true, PoolAllocator, EmptyStatistic, Instr> LCT;
+	LCT lct;
+	vector<LCT::Node *> nodes;
+	for (size_t i = 0 ; i < N ; ++i) nodes.push_back(lct.Add(i));
+	assert(lct.Stats().live_bytes == int64_t(N * sizeof(LCT::Node)));
+
+	// A path, then accesses from its two ends switch preferred children
+	for (size_t i = 1 ; i < N ; ++i) lct.Link(nodes[i], nodes[i - 1]);
+	Instr::Reset();
+	lct.Access(nodes[N - 1]);
+	InstrumentationStats s = lct.Stats();
+	assert(s.accesses == 1 && s.preferred_changes == s.max_preferred_changes);
+	for (size_t i = 0 ; i < N ; ++i) lct.Access(nodes[rand() % N]);
+	s = lct.Stats();
+	assert(s.accesses == N + 1 && s.preferred_changes >= s.max_preferred_changes);
+	assert(s.max_preferred_changes > 1);
+
+	assert(s.reverse_pushes == 0);
+	for (size_t i = 0 ; i < N ; ++i) lct.Evert(nodes[rand() % N]), lct.FindRoot(nodes[rand() % N]);
+	assert(lct.Stats().reverse_pushes > 0);
+
+	for (size_t i = 0 ; i < N ; ++i) lct.Remove(nodes[i]);
+	assert(lct.Stats().live_bytes == 0);
+	std::cout << "Link cut tree counting test Done" << std::endl;
+}
+
+void euler_tree_counting_test(size_t N) {
+	typedef CountingInstrumentation<ETTag> Instr;
+	typedef EulerTree<size_t, true, Statistic, PoolAllocator, Instr> ET;
+	ET et;
+	vector<ET::Node *> nodes;
+	vector<ET::Edge> edges;
+	for (size_t i = 0 ; i < N ; ++i) nodes.push_back(et.Add(i));
+	for (size_t i = 1 ; i < N ; ++i) edges.push_back(et.Link(nodes[i], nodes[rand() % i]));
+	// A tree on N vertices has 2N - 1 occurrences
+	InstrumentationStats s = et.Stats();
+	assert(s.occurrences_created - s.occurrences_dropped == 2 * N - 1);
+	assert(s.live_bytes == int64_t(N * sizeof(ET::Node) + (2 * N - 1) * sizeof(ET::STNode)));
+
+	for (size_t i = 0 ; i < N ; ++i) et.Evert(nodes[rand() % N]);
+	s = et.Stats();
+	assert(s.occurrences_created - s.occurrences_dropped == 2 * N - 1);
+
+	for (size_t i = 0 ; i < edges.size() ; ++i) et.Cut(edges[i]);
+	s = et.Stats();
+	assert(s.occurrences_created - s.occurrences_dropped == N);
+	for (size_t i = 0 ; i < N ; ++i) et.Remove(nodes[i]);
+	s = et.Stats();
+	assert(s.occurrences_created == s.occurrences_dropped && s.live_bytes == 0);
+	assert(s.rotations > 0);
+	std::cout << "Euler tree counting test Done" << std::endl;
+}
+
+int main(int argc, const char *argv[])
+{
+	no_instrumentation_test();
+	splay_tree_counting_test(10000);
+	link_cut_tree_counting_test(1000);
+	euler_tree_counting_test(1000);
+	return 0;
+}
@@ -0,0 +1,108 @@
+#ifndef __LINK_CUT_ACCESS_H__
+#define __LINK_CUT_ACCESS_H__
+
+#include <cassert>
+#include <cstddef>
+
+#include "instrumentation.h"
+
+// Access and the link cut tree operations built on it, shared by the
+// node layouts (LinkCutTree, CompactLinkCutTree). Node names a vertex,
+// a pointer or an index. Tree supplies the layout:
+//   Nil()                  no vertex
+//   Left(v), Right(v)      splay children
+//   Up(v)                  splay parent, or path parent of a splay root
+//   IsSplayRoot(v), Reversed(v)
+//   Splay(v)               v to the top of its splay tree, flags resolved
+//   PushReverse(v)         reverse flag of v handed to its children
+//   Flip(v)                reverse the splay subtree of v lazily
+//   SwitchPreferred(w, v)  v (a splay root hanging from w, or Nil) becomes
+//                          the right child of w, returns 1 if it changed
+//   DetachLeft(v)          the left child of v becomes its own splay tree
+//   AttachLeft(v, w)       the splay tree w becomes the left child of v
+template <class Tree, class Node, bool Evertable, class Instr = NoInstrumentation>
+struct LinkCutAccess {
+	// Returns the last splay root met, the LCA with the previous access
+	static Node Access(Tree &t, Node v) {
+		t.Splay(v);
+		Node last_splay_node = v;
+		size_t changes = t.SwitchPreferred(v, Tree::Nil());
+		Node w = t.Up(v);
+		while (w != Tree::Nil()) {
+			t.Splay(w);
+			last_splay_node = w;
+			changes += t.SwitchPreferred(w, v);
+			assert(!t.IsSplayRoot(v) && t.IsSplayRoot(w));
+			t.Splay(v);
+			w = t.Up(v);
+		}
+		assert(t.IsSplayRoot(v));
+		Instr::Access(changes);
+		return last_splay_node;
+	}
+
+	static Node FindRoot(Tree &t, Node v) {
+		Access(t, v);
+		Node u = v;
+		if (Evertable) t.PushReverse(u);
+		while (t.Left(u) != Tree::Nil()) {
+			u = t.Left(u);
+			if (Evertable) t.PushReverse(u);
+		}
+		t.Splay(u);
+		return u;
+	}
+
+	static void Cut(Tree &t, Node v) {
+		Access(t, v);
+		assert(!t.Reversed(v));
+		if (t.Left(v) != Tree::Nil()) t.DetachLeft(v);
+	}
+
+	// w becomes the parent of v
+	static void Link(Tree &t, Node v, Node w) {
+		assert(v != w);
+		assert(FindRoot(t, v) == v && FindRoot(t, w) != v);
+		Access(t, v);
+		Access(t, w);
+		assert(t.Left(v) == Tree::Nil() && !t.Reversed(v));
+		t.AttachLeft(v, w);
+	}
+
+	static Node FindLCA(Tree &t, Node v, Node w) {
+		if (FindRoot(t, v) != FindRoot(t, w)) return Tree::Nil();
+		Access(t, v);
+		return Access(t, w);
+	}
+
+	static void Evert(Tree &t, Node v) {
+		if (Evertable) {
+			Access(t, v);
+			t.Flip(v);
+		} else {
+			assert(false);
+		}
+	}
+
+	// Rightmost node of the splay tree left of v
+	static Node Parent(Tree &t, Node v) {
+		Access(t, v);
+		assert(!t.Reversed(v));
+		if ((v = t.Left(v)) == Tree::Nil()) return v;
+		if (Evertable) t.PushReverse(v);
+		while (t.Right(v) != Tree::Nil()) {
+			v = t.Right(v);
+			if (Evertable) t.PushReverse(v);
+		}
+		Access(t, v); // Amortization
+		return v;
+	}
+
+	static bool IsRoot(Tree &t, Node v) {
+		Access(t, v);
+		assert(!t.Reversed(v));
+		return t.Left(v) == Tree::Nil();
+	}
+};
+
+#endif /* __LINK_CUT_ACCESS_H__ */
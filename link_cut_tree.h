@@ -2,34 +2,148 @@
 #define __LINK_CUT_TREE_H__
 
 #include <limits>
+#include <cstring>
+#include <cstdint>
+#include <string>
 #include <vector>
+#include <utility>
+#include <algorithm>
+#include <functional>
 #include <unordered_map>
-#include <unordered_set>
 
 #include "splay_tree.h"
+#include "link_cut_access.h"
+#include "frozen_forest.h"
+
+// Aggregate over the represented subtree of a link cut tree node.
+// virt holds the subtrees hanging from the node by path parents, sub the
+// node, its splay subtree and all their virtual subtrees. Access moves
+// children in and out of virt, so the statistic needs Subtract.
+template <class SubStat>
+struct VirtualInfo {
+	SubStat sub, virt;
+	VirtualInfo() { sub.Add(); }
+
+	template <class T, class Node>
+	void UpdateSub(const T& key, const Node *l, const Node *r) {
+		sub.Init(key);
+		if (l) sub.UpdateLeft(l->sub);
+		if (r) sub.UpdateRight(r->sub);
+		sub.UpdateRight(virt);
+	}
+
+	template <class Node>
+	void AddVirtual(const Node *c) { virt.UpdateRight(c->sub); }
+
+	template <class Node>
+	void RemoveVirtual(const Node *c) { virt.Subtract(c->sub); }
+
+	// Path add over n vertices of the splay subtree, virtual ones keep theirs
+	template <class T>
+	void ApplySub(const T& delta, size_t n) { sub.ApplyAdd(delta, n); }
+};
+
+// No subtree aggregate, nothing is stored
+template <>
+struct VirtualInfo<EmptyStatistic> {
+	template <class T, class Node>
+	void UpdateSub(const T& key, const Node *l, const Node *r) {}
+	template <class Node>
+	void AddVirtual(const Node *c) {}
+	template <class Node>
+	void RemoveVirtual(const Node *c) {}
+	template <class T>
+	void ApplySub(const T& delta, size_t n) {}
+};
+
+// The path read backward, kept only for an ordered Stat
+// (IsOrderedStatistic) of an evertable tree. stat and backward of a node
+// always hold its splay subtree in the current order, so a reverse swaps
+// them at once and the children get theirs when it is pushed down
+template <class Stat, bool Ordered>
+struct BackwardInfo {
+	Stat backward;
+
+	// forward was just computed from the same node
+	template <class T, class Node>
+	void UpdateBackward(const Stat& forward, const T& key, const Node *l, const Node *r) {
+		backward = forward; // keeps the counters of the node
+		backward.Init(key);
+		if (r) backward.UpdateLeft(r->backward);
+		if (l) backward.UpdateRight(l->backward);
+	}
+
+	void SwapBackward(Stat& forward) { std::swap(forward, backward); }
+
+	template <class T>
+	void ApplyBackward(bool add, const T& value, size_t n) {
+		if (add) backward.ApplyAdd(value, n);
+		else backward.ApplyAssign(value, n);
+	}
+};
+
+// Both directions are the same, nothing is stored
+template <class Stat>
+struct BackwardInfo<Stat, false> {
+	template <class T, class Node>
+	void UpdateBackward(const Stat& forward, const T& key, const Node *l, const Node *r) {}
+	void SwapBackward(Stat& forward) {}
+	template <class T>
+	void ApplyBackward(bool add, const T& value, size_t n) {}
+};
 
 // Usage Note.
 // To use Remove(), coder make sure that there is no connection to the vertex
+// SubStat, when given, is kept over whole subtrees for Subtree()
+// Path() of an evertable tree is read from the root down, in that order
+// for an ordered Stat (IsOrderedStatistic)
+// Instr is an instrumentation policy (instrumentation.h)
 
-template <class T, class Stat, bool Evertable = false>
+template <class T, class Stat, bool Evertable = false, class Alloc = PoolAllocator,
+	class SubStat = EmptyStatistic, class Instr = NoInstrumentation>
 class LinkCutTree {
 public:
 	typedef T ItemType;
 	// Splay tree is keyed by depth implicitly
 	// we therefore use a comparator always returning false
-	struct Node : BasicTreeNode <Node> {
+	static const bool ORDERED = Evertable && IsOrderedStatistic<Stat>::value;
+	struct Node : BasicTreeNode <Node>, VirtualInfo<SubStat>, BackwardInfo<Stat, ORDERED> {
 		typedef T ItemType;
+		enum { NO_TAG, ADD_TAG, ASSIGN_TAG };
 		T key;
 		Stat stat;
 		bool reverse;
+		unsigned char lazy; // path update pending for the children
+		uint32_t n; // vertices in the splay subtree
+		T tag;
 		Node (const T& key, Node *p = NULL, Node *l = NULL, Node *r = NULL)
-			: key(key), BasicTreeNode<Node>(p,l,r), reverse(false) {}
+			: key(key), BasicTreeNode<Node>(p,l,r), reverse(false), lazy(NO_TAG), n(1), tag() {}
 		// Statistic function should be commutative 
-		// if link cut tree is evertable
+		// if link cut tree is evertable, or ordered (IsOrderedStatistic)
 		void Update() {
 			stat.Init(key);
-			if (this->Left()) stat.UpdateLeft(this->Left()->stat);
-			if (this->Right()) stat.UpdateRight(this->Right()->stat);
+			n = 1;
+			if (this->Left()) stat.UpdateLeft(this->Left()->stat), n += this->Left()->n;
+			if (this->Right()) stat.UpdateRight(this->Right()->stat), n += this->Right()->n;
+			this->UpdateBackward(stat, key, this->Left(), this->Right());
+			this->UpdateSub(key, this->Left(), this->Right());
+		}
+		// Apply a path update to this node and its statistic,
+		// the splay subtree below gets it later through the tag
+		void Apply(unsigned char type, const T& value) {
+			if (type == ADD_TAG) {
+				key += value;
+				stat.ApplyAdd(value, n);
+				this->ApplyBackward(true, value, n);
+				this->ApplySub(value, n);
+				if (lazy == NO_TAG) lazy = ADD_TAG, tag = value;
+				else tag += value; // Add after add or assign folds in
+			} else {
+				key = value;
+				stat.ApplyAssign(value, n);
+				this->ApplyBackward(false, value, n);
+				lazy = ASSIGN_TAG, tag = value;
+			}
 		}
 	};
 
@@ -40,117 +154,130 @@ private:
 		}
 	};
 	
-	typedef SplayTreeBase<T, Node, FalseComp> ST;
-	typedef typename std::unordered_set<Node*> NodeSet;
-	typedef typename NodeSet::iterator ns_it;
+	typedef SplayTreeBase<T, Node, FalseComp, Instr> ST;
+	// Access and what is built on it, over the layout below
+	typedef LinkCutAccess<LinkCutTree, Node*, Evertable, Instr> Ops;
+	friend struct LinkCutAccess<LinkCutTree, Node*, Evertable, Instr>;
+	typedef typename Alloc::template Pool<Node> NodePool;
 
 public:
-	LinkCutTree () : size(0) {}
+	static const size_t NO_PARENT = (size_t)-1;
+
+	LinkCutTree () : size(0), tagged(false) {}
+	// Nodes still held go away with the pool
+	~LinkCutTree() { Instr::Freed(nodes.Size() * sizeof(Node)); }
 	LinkCutTree (const LinkCutTree &) = delete;
-	~LinkCutTree() {
-		for (ns_it it = nodes.begin(); it != nodes.end(); ++it) {
-			(*it)->Left() = (*it)->Right() = NULL;
-			delete (*it);
-		}
-	}
 	
 	Node* Access(Node* v) {
 		assert(v);
-		Splay(v);
-		Node* last_splay_node = v;
-		Node* u = v->Right();
-		Disconnect(v, u);
-		if(u) u->Parent() = v; // Reconnect but using path parent
-		assert(!v->Right());
-		Node* w = v->Parent();
-		while (w) {
-			Splay(w);
-			last_splay_node = w;
-			u = w->Right();
-			Disconnect(w, u);
-			if(u) u->Parent() = w; // Reconnect but using path parent
-			// Merge
-			MergeRight(w, v);
-			assert(!ST::IsRoot(v) && ST::IsRoot(w));
-			Splay(v);
-			w = v->Parent();
-		}
-		assert(ST::IsRoot(v));
-		return last_splay_node;
+		return Ops::Access(*this, v);
 	}
 
 	Node* Add(const T& value) {
 		++size;
-		Node* node = ST::CreateNode(value);
-		nodes.insert(node);
-		return node;
+		return ST::CreateNode(nodes, value);
 	}
 
-	void Remove(Node* v) {
-		Cut(v);
+	// Build a forest in linear time.
+	// Vertex i gets keys[i] and parents[i] as its parent (NO_PARENT for roots).
+	// Every vertex prefers its largest child, and each preferred path
+	// becomes one balanced splay tree, so the first accesses stay shallow.
+	// If preorder is given, (*preorder)[i] is the position of vertex i in
+	// a preorder visiting the preferred child first: every preferred path
+	// is a run of it in depth order (see Query::at).
+	std::vector<Node*> BuildFromParents(const std::vector<T>& keys, const std::vector<size_t>& parents,
+			std::vector<size_t> *preorder = NULL) {
+		assert(keys.size() == parents.size());
+		size_t n = keys.size();
+		std::vector<Node*> vs(n);
+		nodes.Reserve(n);
+		for (size_t i = 0 ; i < n ; ++i) vs[i] = Add(keys[i]);
+
+		// Children lists in one array, then a top-down order of vertices
+		std::vector<size_t> first(n + 1, 0), child(n), order;
+		order.reserve(n);
+		for (size_t i = 0 ; i < n ; ++i) {
+			if (parents[i] == NO_PARENT) order.push_back(i);
+			else assert(parents[i] < n), ++first[parents[i] + 1];
+		}
+		for (size_t i = 0 ; i < n ; ++i) first[i + 1] += first[i];
+		std::vector<size_t> fill(first.begin(), first.end() - 1);
+		for (size_t i = 0 ; i < n ; ++i)
+			if (parents[i] != NO_PARENT) child[fill[parents[i]]++] = i;
+		for (size_t i = 0 ; i < order.size() ; ++i)
+			for (size_t c = first[order[i]] ; c < first[order[i] + 1] ; ++c)
+				order.push_back(child[c]);
+		assert(order.size() == n); // no cycle
+
+		// Subtree sizes and the preferred (heaviest) child
+		std::vector<size_t> subtree(n, 1), heavy(n, NO_PARENT);
+		for (size_t i = n ; i --> 0 ;) {
+			size_t v = order[i];
+			for (size_t c = first[v] ; c < first[v + 1] ; ++c) {
+				size_t u = child[c];
+				subtree[v] += subtree[u];
+				if (heavy[v] == NO_PARENT || subtree[u] > subtree[heavy[v]]) heavy[v] = u;
+			}
+		}
+
+		// Each path head collects its preferred path (ordered by depth).
+		// Bottom-up, so that a path is complete when it hangs from its parent
+		std::vector<Node*> path;
+		for (size_t i = n ; i --> 0 ;) {
+			size_t head = order[i], p = parents[head];
+			if (p != NO_PARENT && heavy[p] == head) continue;
+			path.clear();
+			for (size_t v = head ; v != NO_PARENT ; v = heavy[v]) path.push_back(vs[v]);
+			Node *root = ST::BuildBalanced(path.data(), path.data() + path.size());
+			root->Parent() = (p == NO_PARENT)?NULL:vs[p]; // path parent
+			if (p != NO_PARENT) vs[p]->AddVirtual(root);
+		}
 
-		nodes.erase(v);
+		if (preorder) {
+			preorder->assign(n, 0);
+			std::vector<size_t> stack;
+			size_t at = 0;
+			for (size_t i = 0 ; i < n && parents[order[i]] == NO_PARENT ; ++i) {
+				stack.push_back(order[i]);
+				while (!stack.empty()) {
+					size_t v = stack.back();
+					stack.pop_back();
+					(*preorder)[v] = at++;
+					for (size_t c = first[v] ; c < first[v + 1] ; ++c)
+						if (child[c] != heavy[v]) stack.push_back(child[c]);
+					if (heavy[v] != NO_PARENT) stack.push_back(heavy[v]);
+				}
+			}
+		}
+		return vs;
+	}
 
-		// Delete tree
+	void Remove(Node* v) {
+		Cut(v);
 		--size;
-		delete v;
+		ST::DestroyNode(nodes, v);
 	}
 
 	Node* FindRoot(Node* v) {
-		Access(v);
-		assert(ST::IsRoot(v));
-		Node* u = v;
-		if (Evertable) PushReverse(u);
-		while (u->Left()) {
-			u = u->Left();
-			if (Evertable) PushReverse(u);
-		}
-		Splay(u);
-		return u;
+		return Ops::FindRoot(*this, v);
 	}
 
 	void Cut(Node* v) {
 		assert(v);
-		Access(v);
-		assert(!v->reverse);
-		if (!v->Left())	return;
-		Node* w = v->Left();
-		Disconnect<true>(v, w);
-		// Update path parent
-		assert(ST::IsRoot(w) && ST::IsRoot(v));
-		w->Parent() = v->Parent();
-		v->Parent() = NULL;
+		Ops::Cut(*this, v);
 	}
 
 	// w becomes the parent of v
 	void Link(Node* v, Node* w) {
-		assert(v != w);
-		assert(FindRoot(v) == v && FindRoot(w) != v);
-		Access(v);
-		Access(w);
-		assert(ST::IsRoot(v) && ST::IsRoot(w));
-		assert(v->Left() == NULL);
-	
-		// Before merge inherit the parent information
-		v->Parent() = w->Parent();
-		// Merge
-		MergeLeft(v, w);
-		assert(ST::IsRoot(v) && !ST::IsRoot(w) && w->Parent() == v);
+		Ops::Link(*this, v, w);
 	}
 
 	Node* FindLCA(Node *v, Node *w) {
-		if (FindRoot(v) != FindRoot(w)) return NULL;
-		Access(v);
-		return Access(w);
+		return Ops::FindLCA(*this, v, w);
 	}
 
 	void Evert(Node *v) { 
-		if (Evertable) {
-			Access(v);
-			v->reverse ^= 1;
-		} else {
-			assert(false);
-		}
+		Ops::Evert(*this, v);
 	}
 
 	Stat Path(Node* v) {
@@ -158,58 +285,306 @@ public:
 		return v->stat;
 	}
 
-	Node *Parent(Node *v) {
+	// Add delta to every key on the path from the root to v
+	// Stat needs ApplyAdd (see SumStatistic and MinMaxStatistic)
+	void PathAdd(Node* v, const T& delta) {
 		Access(v);
-		assert(!v->reverse);
-		if (!(v = v->Left())) return NULL;
-		while (v->Right()) {
-			v = v->Right();
-			if (Evertable) PushReverse(v);
-		}
-		Access(v); // Amortization
-		return v;
+		tagged = true;
+		v->Apply(Node::ADD_TAG, delta);
 	}
 
-	bool IsRoot(Node *v) {
+	// Set every key on the path from the root to v to value
+	// Stat needs ApplyAssign (see SumStatistic and MinMaxStatistic)
+	void PathAssign(Node* v, const T& value) {
+		static_assert(IsTrivialStatistic<SubStat>::value,
+				"a subtree aggregate cannot follow an assignment lazily");
 		Access(v);
-		assert(!v->reverse);
-		return v->Left() == NULL;
+		tagged = true;
+		v->Apply(Node::ASSIGN_TAG, value);
+	}
+
+	// SubStat over the subtree of v (rooted at the current root)
+	SubStat Subtree(Node* v) {
+		Access(v);
+		// Every child of v is virtual now
+		SubStat s;
+		s.Add();
+		s.Init(v->key);
+		s.UpdateRight(v->virt);
+		return s;
+	}
+
+	// Key of v with the pending path updates applied
+	const T& Key(Node* v) {
+		Splay(v);
+		return v->key;
+	}
+
+	Node *Parent(Node *v) {
+		return Ops::Parent(*this, v);
+	}
+
+	bool IsRoot(Node *v) {
+		return Ops::IsRoot(*this, v);
+	}
+
+	// Read-only snapshot for query phases, see FrozenForest.
+	// Vertex i of the snapshot is vertices[i], which has to hold every
+	// parent too. Keys come with the pending path updates applied.
+	FrozenForest<T, Stat> Freeze(const std::vector<Node*>& vertices) {
+		typedef typename FrozenForest<T, Stat>::Vertex Vertex;
+		std::unordered_map<Node*, Vertex> index;
+		for (size_t i = 0 ; i < vertices.size() ; ++i) index[vertices[i]] = i;
+		std::vector<T> keys;
+		std::vector<Vertex> parents;
+		keys.reserve(vertices.size()), parents.reserve(vertices.size());
+		for (size_t i = 0 ; i < vertices.size() ; ++i) {
+			Node *p = Parent(vertices[i]);
+			assert(!p || index.count(p));
+			parents.push_back(p?index[p]:FrozenForest<T, Stat>::NONE);
+			keys.push_back(Key(vertices[i]));
+		}
+		return FrozenForest<T, Stat>(keys, parents);
+	}
+
+	// Node of a snapshot file, links are indices into the vertex list
+	struct SnapshotNode {
+		uint32_t parent, left, right; // splay or path parent, NONE for none
+		T key, tag;
+		Stat stat;
+		VirtualInfo<SubStat> info;
+		BackwardInfo<Stat, ORDERED> backward;
+		uint32_t n;
+		bool reverse;
+		unsigned char lazy;
+	};
+
+	// Tagged by the types it stores, the pool and instrumentation do not matter
+	static uint64_t SnapshotNodeTag() {
+		return SnapshotTag<T, Stat, SubStat>();
+	}
+
+	// Writes the forest to a snapshot file (forest_snapshot.h): the
+	// Freeze() of vertices, which has to hold every node of the tree, for
+	// queries straight from the mapped file, then the nodes as they are,
+	// splay shape, statistics, pending tags and reverse flags included.
+	bool Save(const std::string& path, const std::vector<Node*>& vertices, std::string *error = nullptr) {
+		typedef FrozenForest<T, Stat> Frozen;
+		static_assert(!IsAddressStatistic<Stat>::value && !IsAddressStatistic<SubStat>::value,
+			"statistics holding addresses cannot be stored");
+		assert(vertices.size() == size);
+		Frozen frozen = Freeze(vertices);
+		std::unordered_map<const Node*, uint32_t> index;
+		for (size_t i = 0 ; i < vertices.size() ; ++i) index[vertices[i]] = i;
+		std::vector<SnapshotNode> records(vertices.size());
+		memset(static_cast<void *>(records.data()), 0, records.size() * sizeof(SnapshotNode));
+		for (size_t i = 0 ; i < vertices.size() ; ++i) {
+			const Node *x = vertices[i];
+			SnapshotNode &r = records[i];
+			r.parent = x->Parent()?index.at(x->Parent()):Frozen::NONE;
+			r.left = x->Left()?index.at(x->Left()):Frozen::NONE;
+			r.right = x->Right()?index.at(x->Right()):Frozen::NONE;
+			r.key = x->key, r.tag = x->tag, r.stat = x->stat;
+			r.info = static_cast<const VirtualInfo<SubStat>&>(*x);
+			r.backward = static_cast<const BackwardInfo<Stat, ORDERED>&>(*x);
+			r.n = x->n, r.reverse = x->reverse, r.lazy = x->lazy;
+		}
+		SnapshotWriter writer(SnapshotHeader::LINK_CUT_TREE,
+			(Evertable?SnapshotHeader::EVERTABLE:0) | (tagged?SnapshotHeader::TAGGED:0));
+		frozen.Write(writer);
+		writer.Add(records.data(), records.size(), SnapshotNodeTag());
+		return writer.Write(path, error);
+	}
+
+	// Adds the forest of a file written by Save(), vertices gets its nodes
+	// in the order given to Save(). The nodes come from one reserved run
+	// of the pool and are linked by index, nothing is splayed. False, with
+	// nothing added, if the file holds no link cut tree of this type.
+	bool Load(const ForestSnapshot& snapshot, std::vector<Node*>& vertices) {
+		static_assert(!IsAddressStatistic<Stat>::value && !IsAddressStatistic<SubStat>::value,
+			"statistics holding addresses cannot be stored");
+		const uint32_t NONE = FrozenForest<T, Stat>::NONE;
+		size_t n = 0;
+		const SnapshotNode *records = snapshot.Section<SnapshotNode>(FrozenForest<T, Stat>::SECTIONS, n, SnapshotNodeTag());
+		if (!snapshot.Is(SnapshotHeader::LINK_CUT_TREE) || !records) return false;
+		if (snapshot.Flag(SnapshotHeader::EVERTABLE) != Evertable) return false;
+		for (size_t i = 0 ; i < n ; ++i) {
+			const SnapshotNode &r = records[i];
+			if ((r.parent != NONE && r.parent >= n) || (r.left != NONE && r.left >= n)) return false;
+			if (r.right != NONE && r.right >= n) return false;
+		}
+
+		nodes.Reserve(n);
+		vertices.resize(n);
+		for (size_t i = 0 ; i < n ; ++i) vertices[i] = Add(records[i].key);
+		for (size_t i = 0 ; i < n ; ++i) {
+			const SnapshotNode &r = records[i];
+			Node *x = vertices[i];
+			x->Parent() = (r.parent == NONE)?NULL:vertices[r.parent];
+			x->Left() = (r.left == NONE)?NULL:vertices[r.left];
+			x->Right() = (r.right == NONE)?NULL:vertices[r.right];
+			x->tag = r.tag, x->stat = r.stat;
+			static_cast<VirtualInfo<SubStat>&>(*x) = r.info;
+			static_cast<BackwardInfo<Stat, ORDERED>&>(*x) = r.backward;
+			x->n = r.n, x->reverse = r.reverse, x->lazy = r.lazy;
+		}
+		if (snapshot.Flag(SnapshotHeader::TAGGED)) tagged = true;
+		return true;
 	}
 
 	size_t Size() const {
 		return size;
 	}
 
+	// Counters of the instrumentation policy
+	static InstrumentationStats Stats() {
+		return Instr::Stats();
+	}
+
+	// ***************
+	// Batched queries
+	// ***************
+	struct Query {
+		enum Type { FIND_ROOT, PATH, FIND_LCA };
+		Type type;
+		Node *v, *w; // w is used only by FIND_LCA
+		size_t at; // position of v in the tree, e.g. the preorder of BuildFromParents
+		Query(Type type, Node *v, Node *w = NULL, size_t at = 0) : type(type), v(v), w(w), at(at) {}
+	};
+
+	struct Result {
+		Node *node; // FIND_ROOT, FIND_LCA
+		Stat stat;  // PATH
+	};
+
+	// Answer queries [begin, end) into out[0, end - begin).
+	// Same results as calling FindRoot/Path/FindLCA one by one, but
+	// - queries run ordered by at (ties in the given order). With the
+	//   preorder of BuildFromParents, queries on one preferred path run
+	//   back to back by depth, each Access starting where the last one
+	//   left the splay tree, and repeats of a query are answered without
+	//   touching the tree. Links and cuts since the build only make the
+	//   order less local
+	// - roots found by earlier queries are remembered. After Access(v) a
+	//   remembered root sitting in the splay tree of v is the root of v, so
+	//   FIND_ROOT usually skips the walk down, and FIND_LCA needs only its
+	//   two Access calls instead of two FindRoot calls on top of them.
+	// No query changes the represented forest, so remembered roots stay valid
+	void BatchQuery(const Query *begin, const Query *end, Result *out) {
+		size_t n = end - begin;
+		std::vector<std::pair<size_t, size_t> > order(n);
+		for (size_t i = 0 ; i < n ; ++i) order[i] = std::make_pair(begin[i].at, i);
+		std::sort(order.begin(), order.end());
+
+		std::vector<Node *> roots;
+		const Query *prev = NULL;
+		Result *prev_out = NULL;
+		for (size_t k = 0 ; k < n ; ++k) {
+			size_t i = order[k].second;
+			const Query &q = begin[i];
+			Result &r = out[i];
+			if (prev && prev->type == q.type && prev->v == q.v && prev->w == q.w) {
+				r = *prev_out; // Duplicate query
+				continue;
+			}
+			switch (q.type) {
+				case Query::FIND_ROOT:
+					Access(q.v);
+					r.node = AccessedRoot(roots, q.v);
+					break;
+				case Query::PATH:
+					Access(q.v);
+					r.stat = q.v->stat;
+					break;
+				case Query::FIND_LCA: {
+					Access(q.v);
+					Node *root = AccessedRoot(roots, q.v);
+					r.node = Access(q.w);
+					if (AccessedRoot(roots, q.w) != root) r.node = NULL;
+					break;
+				}
+			}
+			prev = &q, prev_out = &r;
+		}
+	}
+
+	std::vector<Result> BatchQuery(const std::vector<Query>& queries) {
+		std::vector<Result> results(queries.size());
+		BatchQuery(queries.data(), queries.data() + queries.size(), results.data());
+		return results;
+	}
+
 	// *************************************************
 	// Reverse functions used only when Evertable = true
 	// *************************************************
 	void PushReverse(Node *v) {
 		if (v->reverse) {
+			Instr::ReversePush();
 			std::swap(v->l, v->r);
-			if (v->l) v->l->reverse ^= 1;
-			if (v->r) v->r->reverse ^= 1;
+			if (v->l) Flip(v->l);
+			if (v->r) Flip(v->r);
 			v->reverse = false;
 		}
 	}
 
 private:
-	void ResolveReverse(Node *v) {
-		// Resolve Reverse flag on the way to the root
+	// Reverse the splay subtree of v lazily. Its own statistic is turned
+	// at once, the children's when the flag is pushed
+	static void Flip(Node *v) {
+		v->reverse ^= 1;
+		v->SwapBackward(v->stat);
+	}
+
+	// Root of the tree of v, which has just been accessed.
+	// The splay tree of v now holds the whole root path, so a known root
+	// is the answer if it reaches v through splay links. Otherwise walk
+	// down like FindRoot does and remember the new root (a few of them are
+	// kept for forests whose queries alternate between trees).
+	Node *AccessedRoot(std::vector<Node *> &roots, Node *v) {
+		for (size_t i = 0 ; i < roots.size() ; ++i) {
+			Node *u = roots[i];
+			for (size_t d = 0 ; d < 32 && u != v && !ST::IsRoot(u) ; ++d) u = u->Parent();
+			if (u == v) return roots[i];
+		}
+		Node *u = v;
+		if (Evertable) PushReverse(u);
+		while (u->Left()) {
+			u = u->Left();
+			if (Evertable) PushReverse(u);
+		}
+		Splay(u);
+		if (roots.size() == 4) roots.erase(roots.begin());
+		roots.push_back(u);
+		return u;
+	}
+
+	void PushTag(Node *v) {
+		if (v->lazy == Node::NO_TAG) return;
+		if (v->Left()) v->Left()->Apply(v->lazy, v->tag);
+		if (v->Right()) v->Right()->Apply(v->lazy, v->tag);
+		v->lazy = Node::NO_TAG;
+	}
+
+	void Resolve(Node *v) {
+		// Resolve Reverse flags and path tags on the way to the root
 		// Sweep through the path from root to v
 		// If there is set flag recursively push down
 		std::vector<Node *> path;
 		path.push_back(v);
 		while(!ST::IsRoot(path.back())) 
 			path.push_back(path.back()->Parent());
-		for (size_t i = path.size() ; i --> 0 ;) 
-			PushReverse(path[i]);
+		for (size_t i = path.size() ; i --> 0 ;) {
+			if (Evertable) PushReverse(path[i]);
+			if (tagged) PushTag(path[i]);
+		}
 	}
 
 	// TODO : Evert check for every splay?? 
 	void Splay(Node *v) {
 		// Find splay tree that v belongs to
 		assert(v);
-		if (Evertable) ResolveReverse(v);
+		// Path tags only cost a sweep once a path update was made
+		if (Evertable || tagged) Resolve(v);
 		if (ST::IsRoot(v)) return;
 		// Splay on node v in the splay tree
 		ST::SplayNode(v);
@@ -217,36 +592,54 @@ private:
 		assert(ST::IsRoot(v));
 	}
 
-	template <bool isLeft = false>
-	void Disconnect(Node* v, Node* w) {
-		if (!w) return;
-		Splay(v);
-		(isLeft)?v->Left()=NULL:v->Right()=NULL;
+	// Layout for Ops (see LinkCutAccess)
+	static Node *Nil() { return NULL; }
+	static Node *Left(Node *v) { return v->Left(); }
+	static Node *Right(Node *v) { return v->Right(); }
+	static Node *Up(Node *v) { return v->Parent(); }
+	static bool IsSplayRoot(Node *v) { return ST::IsRoot(v); }
+	static bool Reversed(Node *v) { return v->reverse; }
+
+	// v is the root of its splay tree and of the represented tree
+	void DetachLeft(Node* v) {
+		Node* w = v->Left();
+		assert(ST::IsRoot(v) && !v->Parent());
+		v->Left() = NULL;
 		w->Parent() = NULL;
 		ST::Update(v);
 	}
 
-	// Attach w to the right of v
-	void MergeRight(Node* v, Node* w) {
-		assert(!v->Right());
-		v->Right() = w;
-		w->Parent() = v;
-		ST::Update(v);
+	// Make v (a splay root hanging from w, or NULL) the preferred child
+	// of w. The old preferred child keeps w as its path parent.
+	// Returns whether the preferred child changed.
+	size_t SwitchPreferred(Node* w, Node* v) {
+		Node* u = w->Right();
+		if (!u && !v) return 0;
+		if (u) w->AddVirtual(u);
+		if (v) w->RemoveVirtual(v);
+		w->Right() = v;
+		ST::Update(w);
+		return 1;
 	}
 	
 	// Attach w to the left of v
-	void MergeLeft(Node* v, Node* w) {
+	void AttachLeft(Node* v, Node* w) {
 		assert(!v->Left());
 		assert(!v->reverse);
+		assert(ST::IsRoot(w) && !w->Parent());
 		v->Left() = w;
 		w->Parent() = v;
 		ST::Update(v);
 	}
 
 	size_t size;
-	NodeSet nodes;	
+	bool tagged; // a path update was made at some point
+	NodePool nodes;
 	
 };
 
+template <class T, class Stat, bool Evertable, class Alloc, class SubStat, class Instr>
+const size_t LinkCutTree<T, Stat, Evertable, Alloc, SubStat, Instr>::NO_PARENT;
+
 #endif
 
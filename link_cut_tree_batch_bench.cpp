@@ -0,0 +1,93 @@
+#include <iostream>
+#include <vector>
+#include <cstdlib>
+#include <chrono>
+
+#include "statistics.h"
+#include "link_cut_tree.h"
+
+using namespace std;
+
+typedef LinkCutTree<size_t, SumStatistic<size_t> > LCT;
+typedef LCT::Node Node;
+typedef LCT::Query Query;
+
+// Queries come from a window of vertices that are close in the tree
+// (hot == false means uniformly random vertices). Positions are given
+// to BatchQuery when pos is not empty
+vector<Query> make_batch(const vector<Node *> &node, const vector<size_t> &pos, size_t batch, bool hot) {
+	size_t N = node.size(), base = rand() % N, span = hot?N / 64:N;
+	vector<Query> queries;
+	for (size_t i = 0; i < batch; ++i) {
+		size_t v = (base + rand() % span) % N, w = (base + rand() % span) % N;
+		queries.push_back(Query(Query::Type(rand() % 3), node[v], node[w], pos.empty()?0:pos[v]));
+	}
+	return queries;
+}
+
+size_t run_loop(LCT &lct, const vector<Query> &queries) {
+	size_t check = 0;
+	for (size_t i = 0; i < queries.size(); ++i) {
+		const Query &q = queries[i];
+		switch (q.type) {
+			case Query::FIND_ROOT: check += (size_t)lct.FindRoot(q.v); break;
+			case Query::PATH: check += lct.Path(q.v).sum; break;
+			case Query::FIND_LCA: check += (size_t)lct.FindLCA(q.v, q.w); break;
+		}
+	}
+	return check;
+}
+
+size_t run_batch(LCT &lct, const vector<Query> &queries) {
+	vector<LCT::Result> results = lct.BatchQuery(queries);
+	size_t check = 0;
+	for (size_t i = 0; i < queries.size(); ++i) {
+		switch (queries[i].type) {
+			case Query::PATH: check += results[i].stat.sum; break;
+			default: check += (size_t)results[i].node; break;
+		}
+	}
+	return check;
+}
+
+void bench(const char *name, size_t N, size_t batch, size_t rounds, bool hot) {
+	// Caterpillar-like random tree: long spine with random attachments
+	vector<size_t> keys(N), par(N, LCT::NO_PARENT);
+	for (size_t i = 0; i < N; ++i) keys[i] = rand() % 100;
+	for (size_t i = 1; i < N; ++i) par[i] = (rand() % 4)?i - 1:rand() % i;
+
+	// The same queries on three copies: a loop, the batch in the given
+	// order, the batch in preorder
+	LCT lct[3];
+	vector<Node *> node[3];
+	vector<size_t> preorder, none;
+	for (size_t k = 0; k < 3; ++k) node[k] = lct[k].BuildFromParents(keys, par, k == 2?&preorder:NULL);
+
+	double time[3] = {0, 0, 0};
+	size_t check[3] = {0, 0, 0};
+	for (size_t r = 0; r < rounds; ++r) {
+		unsigned seed = rand();
+		for (size_t k = 0; k < 3; ++k) {
+			srand(seed);
+			vector<Query> q = make_batch(node[k], k == 2?preorder:none, batch, hot);
+			chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+			check[k] += k?run_batch(lct[k], q):run_loop(lct[k], q);
+			time[k] += chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+		}
+	}
+
+	double ops = double(batch) * rounds;
+	cout << name << ": loop " << size_t(ops / time[0]) << " ops/s, batch "
+		<< size_t(ops / time[1]) << " ops/s (" << time[0] / time[1] << "x), batch in preorder "
+		<< size_t(ops / time[2]) << " ops/s (" << time[0] / time[2] << "x)"
+		<< (check[0] && check[1] && check[2]?"":" (empty)") << endl;
+}
+
+int main(int argc, const char *argv[])
+{
+	size_t N = argc > 1?atol(argv[1]):200000;
+	srand(1);
+	bench("uniform", N, 4096, 50, false);
+	bench("clustered", N, 4096, 50, true);
+	return 0;
+}
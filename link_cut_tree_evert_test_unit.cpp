@@ -2,9 +2,14 @@
 #include <vector>
 #include <cstdlib>
 #include <limits>
+#include <string>
+#include <map>
+#include <cstdio>
+#include <cstdint>
 
 #include "statistics.h"
 #include "link_cut_tree.h"
+#include "forest_snapshot.h"
 
 using namespace std;
 
@@ -59,9 +64,134 @@ void link_cut_tree_evert_test(size_t N) {
 }
 
 
+// Polynomial hash of the keys in path order, which does not commute.
+// A path add moves it by delta times the sum of the powers
+class HashStatistic : public Statistic {
+	public:
+	static const uint64_t MOD = 1000000007, BASE = 131;
+	uint64_t hash, power, powers;
+	HashStatistic() : Statistic(), hash(0), power(1), powers(0) {}
+
+	template <typename T>
+	void Init(const T& key) { hash = key % MOD, power = BASE, powers = 1; }
+
+	void UpdateLeft(const HashStatistic& l) {
+		hash = (l.hash * power + hash) % MOD;
+		powers = (l.powers * power + powers) % MOD;
+		power = l.power * power % MOD;
+	}
+
+	void UpdateRight(const HashStatistic& r) {
+		hash = (hash * r.power + r.hash) % MOD;
+		powers = (powers * r.power + r.powers) % MOD;
+		power = power * r.power % MOD;
+	}
+
+	template <typename T>
+	void ApplyAdd(const T& delta, size_t n) { hash = (hash + delta % MOD * powers) % MOD; }
+
+	template <typename T>
+	void ApplyAssign(const T& value, size_t n) { hash = value % MOD * powers % MOD; }
+};
+
+template <>
+struct IsOrderedStatistic<HashStatistic> { enum { value = true }; };
+
+typedef LinkCutTree<size_t, HashStatistic, true> HashLCT;
+const size_t NONE = numeric_limits<size_t>::max();
+
+// Keys from the root down to v
+uint64_t path_hash(const vector<size_t> &par, const vector<size_t> &key, size_t v) {
+	vector<size_t> path;
+	for (; v != NONE ; v = par[v]) path.push_back(v);
+	uint64_t h = 0;
+	for (size_t i = path.size() ; i-- > 0 ;)
+		h = (h * HashStatistic::BASE + key[path[i]]) % HashStatistic::MOD;
+	return h;
+}
+
+// Ordered path statistic across everts, path updates and a snapshot,
+// against parent pointers
+void link_cut_tree_ordered_test(size_t N) {
+	HashLCT lct;
+	vector<HashLCT::Node *> node;
+	vector<size_t> par(N, NONE), key(N);
+	for (size_t i = 0 ; i < N ; ++i) node.push_back(lct.Add(key[i] = rand() % 1000));
+	for (size_t i = 1 ; i < N ; ++i) {
+		par[i] = rand() % i;
+		lct.Link(node[i], node[par[i]]);
+	}
+
+	for (size_t round = 0 ; round < 2 ; ++round) {
+		for (size_t i = 0 ; i < 4 * N ; ++i) {
+			size_t v = rand() % N, w = rand() % N;
+			switch (rand() % 5) {
+				case 0: { // reroot at v, the path to the old root turns around
+					lct.Evert(node[v]);
+					size_t prev = NONE;
+					for (size_t x = v ; x != NONE ;) {
+						size_t next = par[x];
+						par[x] = prev, prev = x, x = next;
+					}
+					break;
+				}
+				case 1:
+					if (par[v] == NONE) break;
+					lct.Cut(node[v]);
+					par[v] = NONE;
+					break;
+				case 2:
+					lct.Evert(node[v]);
+					for (size_t x = v, prev = NONE ; x != NONE ;) {
+						size_t next = par[x];
+						par[x] = prev, prev = x, x = next;
+					}
+					if (lct.FindRoot(node[w]) == node[v]) break;
+					lct.Link(node[v], node[w]);
+					par[v] = w;
+					break;
+				case 3: {
+					size_t delta = rand() % 10;
+					lct.PathAdd(node[v], delta);
+					for (size_t x = v ; x != NONE ; x = par[x]) key[x] += delta;
+					break;
+				}
+				case 4: {
+					size_t value = rand() % 1000;
+					lct.PathAssign(node[v], value);
+					for (size_t x = v ; x != NONE ; x = par[x]) key[x] = value;
+					break;
+				}
+			}
+			assert(lct.Path(node[v]).hash == path_hash(par, key, v));
+		}
+		for (size_t v = 0 ; v < N ; ++v)
+			assert(lct.Path(node[v]).hash == path_hash(par, key, v));
+
+		// The backward statistics and pending reverses go through a file
+		const string path = "lct_evert_test_ordered.snap";
+		assert(lct.Save(path, node));
+		HashLCT loaded;
+		vector<HashLCT::Node *> loaded_node;
+		assert(loaded.Load(*ForestSnapshot::Open(path), loaded_node));
+		remove(path.c_str());
+		for (size_t v = 0 ; v < N ; ++v) {
+			size_t w = rand() % N;
+			loaded.Evert(loaded_node[w]), lct.Evert(node[w]);
+			assert(loaded.Path(loaded_node[v]).hash == lct.Path(node[v]).hash);
+		}
+		map<HashLCT::Node *, size_t> index;
+		for (size_t v = 0 ; v < N ; ++v) index[node[v]] = v;
+		for (size_t v = 0 ; v < N ; ++v)
+			par[v] = lct.Parent(node[v])?index[lct.Parent(node[v])]:NONE;
+	}
+	std::cout << "Ordered statistic test Done." << std::endl;
+}
+
 int main(int argc, const char *argv[])
 {
 	link_cut_tree_evert_test(10000);
+	link_cut_tree_ordered_test(500);
 
 	return 0;
 }
@@ -2,6 +2,7 @@
 #include <vector>
 #include <cstdlib>
 #include <limits>
+#include <thread>
 
 #include "statistics.h"
 #include "link_cut_tree.h"
@@ -72,6 +73,234 @@ void link_cut_tree_sum_test(size_t N) {
 	std::cout << "Sum test Done" << std::endl;
 }
 
+void link_cut_tree_build_test(size_t N) {
+	LCT2 lct;
+	vector<size_t> rank(N, 0);
+	vector<size_t> dist(N, 0);
+	vector<size_t> par(N, LCT2::NO_PARENT);
+
+	// A random forest given as a parent array in shuffled order
+	vector<size_t> perm(N);
+	for (size_t i = 0; i < N; ++i) perm[i] = i;
+	for (size_t i = N - 1; i > 0; --i) std::swap(perm[i], perm[rand() % (i + 1)]);
+	for (size_t i = 0; i < N; ++i) rank[i] = rand() % N + 1;
+	for (size_t i = 1; i < N; ++i)
+		if (rand() % 50) par[perm[i]] = perm[rand() % i];
+
+	vector<Node2 *> node = lct.BuildFromParents(rank, par);
+	assert(lct.Size() == N);
+
+	for (size_t i = 0; i < N; ++i) {
+		size_t cur = i;
+		dist[i] = rank[i];
+		while (par[cur] != LCT2::NO_PARENT) cur = par[cur], dist[i] += rank[cur];
+		assert(lct.FindRoot(node[i]) == node[cur]);
+	}
+
+	for (size_t i = 0; i < N; ++i) {
+		assert(lct.Path(node[i]).sum == dist[i]);
+		Node2 *p = lct.Parent(node[i]);
+		assert(par[i] == LCT2::NO_PARENT?!p:p == node[par[i]]);
+	}
+
+	// The built forest keeps working with Cut and Link
+	for (size_t i = 1; i < N; ++i) {
+		size_t v = perm[i];
+		lct.Cut(node[v]);
+		lct.Link(node[v], node[perm[0]]);
+		assert(lct.Path(node[v]).sum == rank[v] + rank[perm[0]]);
+	}
+
+	std::cout << "Build test Done" << std::endl;
+}
+
+void link_cut_tree_batch_test(size_t N) {
+	typedef LCT2::Query Query;
+	LCT2 lct;
+	vector<size_t> keys(N), par(N, LCT2::NO_PARENT);
+	for (size_t i = 0; i < N; ++i) keys[i] = rand() % N + 1;
+	for (size_t i = 1; i < N; ++i)
+		if (rand() % 20) par[i] = rand() % i;
+	vector<size_t> preorder;
+	vector<Node2 *> node = lct.BuildFromParents(keys, par, &preorder);
+
+	// A preorder: every position once, parents before their children
+	vector<bool> seen(N, false);
+	for (size_t i = 0; i < N; ++i) {
+		assert(preorder[i] < N && !seen[preorder[i]]);
+		seen[preorder[i]] = true;
+		assert(par[i] == LCT2::NO_PARENT || preorder[par[i]] < preorder[i]);
+	}
+
+	// Half of the batches come with positions, answers stay in input order
+	vector<Query> queries;
+	for (size_t i = 0; i < 4 * N; ++i) {
+		size_t v = rand() % N;
+		// Skewed towards a few hot vertices to get duplicates
+		if (rand() % 4 == 0) v = rand() % 16;
+		size_t at = (i / 1000) % 2?preorder[v]:0;
+		queries.push_back(Query(Query::Type(rand() % 3), node[v], node[rand() % N], at));
+	}
+	vector<LCT2::Result> results;
+	for (size_t i = 0; i < queries.size(); i += 1000) {
+		vector<Query> batch(queries.begin() + i, queries.begin() + min(i + 1000, queries.size()));
+		vector<LCT2::Result> part = lct.BatchQuery(batch);
+		results.insert(results.end(), part.begin(), part.end());
+	}
+
+	for (size_t i = 0; i < queries.size(); ++i) {
+		const Query &q = queries[i];
+		switch (q.type) {
+			case Query::FIND_ROOT:
+				assert(results[i].node == lct.FindRoot(q.v)); break;
+			case Query::PATH:
+				assert(results[i].stat.sum == lct.Path(q.v).sum); break;
+			case Query::FIND_LCA:
+				assert(results[i].node == lct.FindLCA(q.v, q.w)); break;
+		}
+	}
+
+	std::cout << "Batch test Done" << std::endl;
+}
+
+template <bool Evertable>
+void link_cut_tree_path_update_test(size_t N) {
+	// Sum and min/max live in two trees that get the same operations
+	typedef LinkCutTree<long long, SumStatistic<long long>, Evertable> SLCT;
+	typedef LinkCutTree<long long, MinMaxStatistic<long long>, Evertable> MLCT;
+	SLCT lct;
+	MLCT mlct;
+	vector<typename SLCT::Node *> node;
+	vector<typename MLCT::Node *> mnode;
+	vector<long long> key(N);
+	vector<size_t> par(N, N);
+	for (size_t i = 0; i < N; ++i) {
+		key[i] = rand() % 100;
+		node.push_back(lct.Add(key[i]));
+		mnode.push_back(mlct.Add(key[i]));
+	}
+	for (size_t i = 1; i < N; ++i) {
+		par[i] = rand() % i;
+		lct.Link(node[i], node[par[i]]);
+		mlct.Link(mnode[i], mnode[par[i]]);
+	}
+
+	for (size_t it = 0; it < 20 * N; ++it) {
+		size_t v = rand() % N;
+		switch (rand() % 6) {
+			case 0: {
+				long long d = rand() % 21 - 10;
+				lct.PathAdd(node[v], d);
+				mlct.PathAdd(mnode[v], d);
+				for (size_t u = v; u != N; u = par[u]) key[u] += d;
+				break;
+			}
+			case 1: {
+				long long x = rand() % 100;
+				lct.PathAssign(node[v], x);
+				mlct.PathAssign(mnode[v], x);
+				for (size_t u = v; u != N; u = par[u]) key[u] = x;
+				break;
+			}
+			case 2: {
+				// Move the subtree of v under a vertex outside of it
+				if (par[v] == N) break;
+				size_t w = rand() % N, u = w;
+				while (u != N && u != v) u = par[u];
+				if (u == v) break;
+				lct.Cut(node[v]);
+				lct.Link(node[v], node[w]);
+				mlct.Cut(mnode[v]);
+				mlct.Link(mnode[v], mnode[w]);
+				par[v] = w;
+				break;
+			}
+			case 3:
+				if (!Evertable) break;
+				lct.Evert(node[v]);
+				mlct.Evert(mnode[v]);
+				for (size_t u = v, p = N; u != N;) {
+					size_t next = par[u];
+					par[u] = p, p = u, u = next;
+				}
+				break;
+			case 4:
+				assert(lct.Key(node[v]) == key[v] && mlct.Key(mnode[v]) == key[v]);
+				break;
+			default: {
+				long long sum = 0, mn = key[v], mx = key[v];
+				for (size_t u = v; u != N; u = par[u])
+					sum += key[u], mn = min(mn, key[u]), mx = max(mx, key[u]);
+				assert(lct.Path(node[v]).sum == sum);
+				MinMaxStatistic<long long> stat = mlct.Path(mnode[v]);
+				assert(stat.min_weight == mn && stat.max_weight == mx);
+			}
+		}
+	}
+	for (size_t i = 0; i < N; ++i) assert(lct.Key(node[i]) == key[i]);
+
+	std::cout << "Path update test Done" << std::endl;
+}
+
+void link_cut_tree_subtree_test(size_t N) {
+	typedef LinkCutTree<long long, SumStatistic<long long>, true, PoolAllocator,
+		SumStatistic<long long> > SLCT;
+	typedef LinkCutTree<long long, SumStatistic<long long>, true, PoolAllocator,
+		SubtreeSizeStatistic> CLCT;
+	SLCT lct;
+	CLCT clct;
+	vector<long long> key(N);
+	vector<size_t> par(N, SLCT::NO_PARENT);
+	for (size_t i = 0; i < N; ++i) key[i] = rand() % 100;
+	for (size_t i = 1; i < N; ++i)
+		if (rand() % 10) par[i] = rand() % i;
+	vector<typename SLCT::Node *> node = lct.BuildFromParents(key, par);
+	vector<typename CLCT::Node *> cnode = clct.BuildFromParents(key, par);
+
+	for (size_t it = 0; it < 20 * N; ++it) {
+		size_t v = rand() % N;
+		switch (rand() % 5) {
+			case 0:
+				lct.Evert(node[v]), clct.Evert(cnode[v]);
+				for (size_t u = v, p = SLCT::NO_PARENT; u != SLCT::NO_PARENT;) {
+					size_t next = par[u];
+					par[u] = p, p = u, u = next;
+				}
+				break;
+			case 1: {
+				if (par[v] == SLCT::NO_PARENT) break;
+				lct.Cut(node[v]), clct.Cut(cnode[v]);
+				par[v] = SLCT::NO_PARENT;
+				size_t w = rand() % N, u = w;
+				while (u != SLCT::NO_PARENT && u != v) u = par[u];
+				if (u == v) break;
+				lct.Link(node[v], node[w]), clct.Link(cnode[v], cnode[w]);
+				par[v] = w;
+				break;
+			}
+			case 2: {
+				long long d = rand() % 21 - 10;
+				lct.PathAdd(node[v], d);
+				for (size_t u = v; u != SLCT::NO_PARENT; u = par[u]) key[u] += d;
+				break;
+			}
+			default: {
+				long long sum = 0;
+				size_t size = 0;
+				for (size_t x = 0; x < N; ++x) {
+					size_t u = x;
+					while (u != SLCT::NO_PARENT && u != v) u = par[u];
+					if (u == v) sum += key[x], ++size;
+				}
+				assert(lct.Subtree(node[v]).sum == sum);
+				assert(clct.Subtree(cnode[v]).ss == size);
+			}
+		}
+	}
+
+	std::cout << "Subtree test Done" << std::endl;
+}
+
 typedef LinkCutTree<size_t, SubtreeSizeStatistic> LCT;
 typedef typename LCT::Node Node;
 
@@ -111,9 +340,64 @@ void link_cut_tree_simple_test(size_t N) {
 	std::cout << "I'm Done" << std::endl;
 }
 
+void link_cut_tree_freeze_test(size_t N, size_t threads) {
+	typedef LinkCutTree<size_t, SumStatistic<size_t>, true> LCT;
+	typedef FrozenForest<size_t, SumStatistic<size_t> > Frozen;
+	LCT lct;
+	vector<size_t> keys(N), par(N, LCT::NO_PARENT);
+	for (size_t i = 0; i < N; ++i) keys[i] = rand() % N + 1;
+	for (size_t i = 1; i < N; ++i)
+		if (rand() % 20) par[i] = rand() % i;
+	vector<LCT::Node *> node = lct.BuildFromParents(keys, par);
+	// Reroot some trees and leave path updates pending
+	for (size_t i = 0; i < N / 10; ++i) lct.Evert(node[rand() % N]);
+	for (size_t i = 0; i < N / 10; ++i) lct.PathAdd(node[rand() % N], rand() % 10);
+
+	// Answers of the live tree
+	std::unordered_map<LCT::Node *, size_t> index;
+	index[NULL] = Frozen::NONE;
+	for (size_t i = 0; i < N; ++i) index[node[i]] = i;
+	vector<size_t> root(N), parent(N), path(N), key(N), qv(N), qw(N), lca(N);
+	for (size_t i = 0; i < N; ++i) {
+		root[i] = index[lct.FindRoot(node[i])];
+		parent[i] = index[lct.Parent(node[i])];
+		path[i] = lct.Path(node[i]).sum;
+		key[i] = lct.Key(node[i]);
+		qv[i] = rand() % N, qw[i] = rand() % N;
+		lca[i] = index[lct.FindLCA(node[qv[i]], node[qw[i]])];
+	}
+
+	const Frozen frozen = lct.Freeze(node);
+	assert(frozen.Size() == N);
+	// Readers share the snapshot
+	vector<std::thread> readers;
+	for (size_t t = 0; t < threads; ++t) readers.push_back(std::thread([&, t]() {
+		for (size_t i = t; i < N; i += threads) {
+			assert(frozen.FindRoot(i) == root[i]);
+			assert(frozen.Parent(i) == parent[i]);
+			assert(frozen.Path(i).sum == path[i]);
+			assert(frozen.Key(i) == key[i]);
+			assert(frozen.FindLCA(qv[i], qw[i]) == lca[i]);
+			size_t d = frozen.Depth(i);
+			assert(frozen.Ancestor(i, d) == frozen.FindRoot(i));
+			assert(frozen.Ancestor(i, d + 1) == Frozen::NONE);
+			assert(d == 0 || frozen.Ancestor(i, 1) == frozen.Parent(i));
+		}
+	}));
+	for (size_t t = 0; t < threads; ++t) readers[t].join();
+
+	std::cout << "Freeze test Done" << std::endl;
+}
+
 int main(int argc, const char *argv[])
 {
 	link_cut_tree_simple_test(10000);
 	link_cut_tree_sum_test(10000);
+	link_cut_tree_build_test(10000);
+	link_cut_tree_batch_test(10000);
+	link_cut_tree_path_update_test<false>(1000);
+	link_cut_tree_path_update_test<true>(1000);
+	link_cut_tree_subtree_test(500);
+	link_cut_tree_freeze_test(10000, 4);
 	return 0;
 }
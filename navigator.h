@@ -1,13 +1,25 @@
-// This is navigator function to find elements at rank
-// Rank starts from 0
+#ifndef __NAVIGATOR_H__
+#define __NAVIGATOR_H__
+
+#include <cassert>
+
+#include "statistics.h"
+
+// Navigators steer the walks of SplayTree::Find and NavigatorSearch.
+// A navigator derives from NavigatorBasic and provides
+//   void Init();                    called once before the walk
+//   Direction Next(const Node *c);  where to go from node c
+// The walks are templates on the navigator type, so both calls are bound
+// statically and inline into the loop (there is nothing virtual).
 class NavigatorBasic {
 	public:
 	enum Direction { LEFT, RIGHT, TARGET, LOST, UP };
-	virtual void Init() = 0;
-	template <class Node>	
-	Direction Next(const Node *) {}
+	void Init() {}
 };
 
+// This is navigator function to find elements at rank
+// Rank starts from 0
+
 class RankNavigator : public NavigatorBasic {
 	public:
 	unsigned int rank, cnt;
@@ -102,3 +114,63 @@ class PredNavigator : public NavigatorBasic {
 	}
 };
 
+
+// First node whose prefix statistic, over the keys before it and itself,
+// is not less than bound (Upper: greater than bound), for statistics that
+// only grow along the order. The prefix is built with UpdateRight, and the
+// node alone is its stat re-initialized from its key as in StatisticComp.
+template <class Stat, class Less, bool Upper = false>
+class StatBoundNavigator : public NavigatorBasic {
+	public:
+	Stat bound, prefix;
+	Less less;
+
+	StatBoundNavigator(const Stat &bound, Less less = Less()) : bound(bound), less(less) {}
+
+	void Init() {
+		prefix = Stat();
+	}
+
+	template <class Node>
+	Direction Next(const Node *c) {
+		Stat s = prefix;
+		if (c->Left()) {
+			s.UpdateRight(c->Left()->stat);
+			if (Reached(s)) return LEFT;
+		}
+		Stat self = c->stat;
+		self.Init(c->key);
+		s.UpdateRight(self);
+		if (Reached(s)) return TARGET;
+		prefix = s;
+		return RIGHT;
+	}
+
+	private:
+	bool Reached(const Stat &s) const {
+		return Upper?less(bound, s):!less(s, bound);
+	}
+};
+
+template <class Stat>
+struct SumLess {
+	bool operator()(const Stat &a, const Stat &b) const { return a.sum < b.sum; }
+};
+
+// Weighted rank: the first key at which the running sum of keys
+// (SumStatistic) reaches threshold, or goes past it when Upper
+template <class T, class Stat = SumStatistic<T>, bool Upper = false>
+class PrefixSumNavigator : public StatBoundNavigator<Stat, SumLess<Stat>, Upper> {
+	public:
+	PrefixSumNavigator(const T &threshold)
+		: StatBoundNavigator<Stat, SumLess<Stat>, Upper>(Bound(threshold)) {}
+
+	private:
+	static Stat Bound(const T &threshold) {
+		Stat s;
+		s.sum = threshold;
+		return s;
+	}
+};
+
+#endif
@@ -0,0 +1,76 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <chrono>
+
+#include "statistics.h"
+#include "link_cut_tree.h"
+#include "euler_tree.h"
+#include "forest_snapshot.h"
+#include "bench_workload.h"
+
+using namespace std;
+
+typedef LinkCutTree<size_t, SumStatistic<size_t>, true> LCT;
+typedef EulerTree<size_t> ET;
+typedef chrono::steady_clock Clock;
+
+double ms_since(Clock::time_point t0) {
+	return chrono::duration<double, milli>(Clock::now() - t0).count();
+}
+
+void row(const char *name, double ms) {
+	cout << "  " << left << setw(34) << name << right << setw(10) << ms << " ms" << endl;
+}
+
+// Warm-up from a dump (one Add and Link per vertex) against the snapshot
+// paths: Load of the live tree, Map of the query arrays
+template <class Forest, class Frozen>
+void bench(const char *name, const vector<size_t> &par, const string &path) {
+	size_t n = par.size();
+	cout << name << ", n = " << n << endl;
+	Clock::time_point t0 = Clock::now();
+	{
+		Forest forest;
+		vector<typename Forest::Node *> nodes;
+		for (size_t i = 0 ; i < n ; ++i) nodes.push_back(forest.Add(i));
+		for (size_t i = 1 ; i < n ; ++i) forest.Link(nodes[i], nodes[par[i]]);
+		row("Add + Link", ms_since(t0));
+
+		t0 = Clock::now();
+		forest.Save(path, nodes);
+		row("Save", ms_since(t0));
+	}
+
+	t0 = Clock::now();
+	shared_ptr<const ForestSnapshot> snapshot = ForestSnapshot::Open(path);
+	row("Open, checksum verified", ms_since(t0));
+	t0 = Clock::now();
+	{
+		Forest forest;
+		vector<typename Forest::Node *> nodes;
+		forest.Load(*snapshot, nodes);
+		row("Load live forest", ms_since(t0));
+	}
+
+	t0 = Clock::now();
+	Frozen frozen;
+	frozen.Map(ForestSnapshot::Open(path, nullptr, false));
+	size_t check = 0;
+	for (size_t i = 0 ; i < 1000 ; ++i) check += frozen.FindRoot(rand() % n);
+	row("Open unverified, Map, 1000 queries", ms_since(t0));
+	if (check == size_t(-1)) cout << "  (unlikely)" << endl;
+	remove(path.c_str());
+}
+
+int main(int argc, const char *argv[])
+{
+	size_t n = argc > 1?atol(argv[1]):1000000;
+	srand(1);
+	vector<size_t> par = MakeShape(RANDOM_TREE, n);
+	bench<LCT, FrozenForest<size_t, SumStatistic<size_t> > >("LinkCutTree evertable", par, "snapshot_bench_lct.snap");
+	bench<ET, FrozenForest<size_t, Statistic> >("EulerTree evertable", par, "snapshot_bench_et.snap");
+	return 0;
+}
@@ -0,0 +1,209 @@
+#include <iostream>
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstdlib>
+#include <cassert>
+
+#include "statistics.h"
+#include "link_cut_tree.h"
+#include "euler_tree.h"
+#include "forest_snapshot.h"
+
+using namespace std;
+
+typedef LinkCutTree<size_t, SumStatistic<size_t>, true, PoolAllocator, SubtreeSizeStatistic> LCT;
+typedef FrozenForest<size_t, SumStatistic<size_t> > Frozen;
+
+// Random forest with everts and pending path updates
+void random_lct(LCT &lct, vector<LCT::Node *> &nodes, size_t n) {
+	for (size_t i = 0 ; i < n ; ++i) nodes.push_back(lct.Add(rand() % 100));
+	for (size_t i = 0 ; i < 2 * n ; ++i) {
+		LCT::Node *v = nodes[rand() % n], *w = nodes[rand() % n];
+		switch (rand() % 4) {
+			case 0:
+				lct.Evert(v);
+				if (lct.FindRoot(w) != v) lct.Link(v, w);
+				break;
+			case 1: lct.Cut(v); break;
+			case 2: lct.PathAdd(v, rand() % 10); break;
+			case 3: lct.Evert(v); break;
+		}
+	}
+}
+
+void lct_compare(LCT &a, vector<LCT::Node *> &va, LCT &b, vector<LCT::Node *> &vb) {
+	size_t n = va.size();
+	for (size_t i = 0 ; i < n ; ++i) {
+		size_t j = rand() % n;
+		assert(a.Key(va[i]) == b.Key(vb[i]));
+		assert(a.Path(va[i]).sum == b.Path(vb[i]).sum);
+		assert(a.Subtree(va[i]).ss == b.Subtree(vb[i]).ss);
+		LCT::Node *ra = a.FindRoot(va[i]), *rb = b.FindRoot(vb[i]);
+		assert(a.Key(ra) == b.Key(rb));
+		LCT::Node *la = a.FindLCA(va[i], va[j]), *lb = b.FindLCA(vb[i], vb[j]);
+		assert(!la == !lb && (!la || a.Key(la) == b.Key(lb)));
+	}
+}
+
+void link_cut_tree_snapshot_test(size_t n) {
+	const string path = "snapshot_test_lct.snap";
+	LCT lct;
+	vector<LCT::Node *> nodes;
+	random_lct(lct, nodes, n);
+	string error;
+	assert(lct.Save(path, nodes, &error));
+
+	shared_ptr<const ForestSnapshot> snapshot = ForestSnapshot::Open(path, &error);
+	assert(snapshot);
+	assert(snapshot->Is(SnapshotHeader::LINK_CUT_TREE) && snapshot->Flag(SnapshotHeader::EVERTABLE));
+
+	// Queries straight from the file
+	Frozen frozen;
+	assert(frozen.Map(snapshot) && frozen.Size() == n);
+	Frozen copy = frozen;
+	snapshot.reset(); // the copies hold the mapping
+	for (size_t v = 0 ; v < n ; ++v) {
+		Frozen::Vertex p = frozen.Parent(v);
+		LCT::Node *lp = lct.Parent(nodes[v]);
+		assert(p == Frozen::NONE?!lp:lp == nodes[p]);
+		assert(nodes[frozen.FindRoot(v)] == lct.FindRoot(nodes[v]));
+		assert(frozen.Path(v).sum == lct.Path(nodes[v]).sum && copy.Key(v) == lct.Key(nodes[v]));
+	}
+
+	// The live tree, pending tags and reverse flags included
+	LCT loaded;
+	vector<LCT::Node *> loaded_nodes;
+	assert(loaded.Load(*ForestSnapshot::Open(path), loaded_nodes));
+	assert(loaded.Size() == n && loaded_nodes.size() == n);
+	lct_compare(lct, nodes, loaded, loaded_nodes);
+	for (size_t i = 0 ; i < n ; ++i) {
+		size_t v = rand() % n, w = rand() % n;
+		switch (rand() % 3) {
+			case 0:
+				lct.Evert(nodes[v]), loaded.Evert(loaded_nodes[v]);
+				if (lct.FindRoot(nodes[w]) != nodes[v])
+					lct.Link(nodes[v], nodes[w]), loaded.Link(loaded_nodes[v], loaded_nodes[w]);
+				break;
+			case 1: lct.Cut(nodes[v]), loaded.Cut(loaded_nodes[v]); break;
+			case 2: lct.PathAdd(nodes[v], w), loaded.PathAdd(loaded_nodes[v], w); break;
+		}
+	}
+	lct_compare(lct, nodes, loaded, loaded_nodes);
+	remove(path.c_str());
+	std::cout << "Link cut tree snapshot test Done" << std::endl;
+}
+
+template <class ET>
+void EulerTreeSnapshotTest(size_t n) {
+	typedef typename ET::Node Node;
+	typedef typename ET::Edge Edge;
+	const string path = "snapshot_test_et.snap";
+	ET et;
+	vector<Node *> nodes;
+	for (size_t i = 0 ; i < n ; ++i) nodes.push_back(et.Add(i));
+	for (size_t i = 1 ; i < n ; ++i)
+		if (rand() % 8) et.Link(nodes[i], nodes[rand() % i]);
+	if (et.EVERTABLE)
+		for (size_t i = 0 ; i < n ; ++i) et.Evert(nodes[rand() % n]);
+	assert(et.Save(path, nodes));
+
+	shared_ptr<const ForestSnapshot> snapshot = ForestSnapshot::Open(path);
+	assert(snapshot && snapshot->Is(SnapshotHeader::EULER_TREE));
+	FrozenForest<size_t, Statistic> frozen;
+	assert(frozen.Map(snapshot));
+
+	ET loaded;
+	vector<Node *> loaded_nodes;
+	vector<Edge> edges;
+	assert(loaded.Load(*snapshot, loaded_nodes, &edges));
+	assert(loaded.Size() == n);
+	for (size_t v = 0 ; v < n ; ++v) {
+		size_t w = rand() % n;
+		Node *p = et.Parent(nodes[v]), *lp = loaded.Parent(loaded_nodes[v]);
+		assert(!p == !lp && (!p || p->key == lp->key));
+		assert(frozen.Parent(v) == (p?p->key:Frozen::NONE));
+		assert(!edges[v] == !lp);
+		assert(et.FindRoot(nodes[v])->key == loaded.FindRoot(loaded_nodes[v])->key);
+		if (et.FindRoot(nodes[v]) != et.FindRoot(nodes[w])) continue;
+		Node *l = et.FindLCA(nodes[v], nodes[w]), *ll = loaded.FindLCA(loaded_nodes[v], loaded_nodes[w]);
+		assert(l && ll && l->key == ll->key);
+	}
+
+	// Keep going on the loaded forest with the edges Load gave
+	for (size_t v = 0 ; v < n ; ++v) {
+		if (!edges[v]) continue;
+		loaded.Cut(edges[v]);
+		assert(!loaded.Parent(loaded_nodes[v]) && loaded.FindRoot(loaded_nodes[v]) == loaded_nodes[v]);
+	}
+	for (size_t v = 0 ; v < n ; ++v) loaded.Remove(loaded_nodes[v]);
+	assert(loaded.Size() == 0);
+	remove(path.c_str());
+	std::cout << "Euler tree snapshot test Done" << std::endl;
+}
+
+void RejectTest(size_t n) {
+	const string path = "snapshot_test_reject.snap";
+	LCT lct;
+	vector<LCT::Node *> nodes;
+	random_lct(lct, nodes, n);
+	assert(lct.Save(path, nodes));
+	string error;
+
+	// Another type of tree or statistic
+	shared_ptr<const ForestSnapshot> snapshot = ForestSnapshot::Open(path);
+	EulerTree<size_t> et;
+	vector<EulerTree<size_t>::Node *> et_nodes;
+	assert(!et.Load(*snapshot, et_nodes) && et.Size() == 0);
+	LinkCutTree<size_t, SumStatistic<size_t> > plain;
+	vector<LinkCutTree<size_t, SumStatistic<size_t> >::Node *> plain_nodes;
+	assert(!plain.Load(*snapshot, plain_nodes) && plain.Size() == 0);
+	FrozenForest<size_t, MinMaxStatistic<size_t> > wrong;
+	assert(!wrong.Map(snapshot));
+	// Records of the same size, other types
+	typedef LinkCutTree<double, SumStatistic<double>, true, PoolAllocator, SubtreeSizeStatistic> Floating;
+	static_assert(sizeof(Floating::SnapshotNode) == sizeof(LCT::SnapshotNode), "same record size");
+	Floating floating;
+	vector<Floating::Node *> floating_nodes;
+	assert(!floating.Load(*snapshot, floating_nodes) && floating.Size() == 0);
+	FrozenForest<double, SumStatistic<double> > floating_frozen;
+	assert(!floating_frozen.Map(snapshot));
+	// The pool does not matter
+	typedef LinkCutTree<size_t, SumStatistic<size_t>, true, HugePagePoolAllocator, SubtreeSizeStatistic> Huge;
+	Huge huge;
+	vector<Huge::Node *> huge_nodes;
+	assert(huge.Load(*snapshot, huge_nodes) && huge.Size() == n);
+	snapshot.reset();
+
+	// A flipped byte, then a header from a later version
+	FILE *file = fopen(path.c_str(), "r+b");
+	fseek(file, sizeof(SnapshotHeader) + 100, SEEK_SET);
+	int c = fgetc(file);
+	fseek(file, sizeof(SnapshotHeader) + 100, SEEK_SET);
+	fputc(c ^ 1, file);
+	fclose(file);
+	assert(!ForestSnapshot::Open(path, &error));
+	assert(error.find("checksum") != string::npos);
+	assert(ForestSnapshot::Open(path, &error, false));
+
+	file = fopen(path.c_str(), "r+b");
+	uint32_t version = SNAPSHOT_VERSION + 1;
+	fseek(file, offsetof(SnapshotHeader, version), SEEK_SET);
+	fwrite(&version, sizeof(version), 1, file);
+	fclose(file);
+	assert(!ForestSnapshot::Open(path, &error, false));
+	assert(error.find("version") != string::npos);
+	assert(!ForestSnapshot::Open("snapshot_test_missing.snap", &error));
+	remove(path.c_str());
+	std::cout << "Reject test Done" << std::endl;
+}
+
+int main(int argc, const char *argv[])
+{
+	link_cut_tree_snapshot_test(2000);
+	EulerTreeSnapshotTest<EulerTree<size_t> >(2000);
+	EulerTreeSnapshotTest<EulerTree<size_t, false> >(2000);
+	EulerTreeSnapshotTest<LCAEulerTree<size_t> >(2000);
+	RejectTest(500);
+	return 0;
+}
@@ -0,0 +1,246 @@
+#ifndef __SPLAY_SEQUENCE_H__
+#define __SPLAY_SEQUENCE_H__
+
+#include <cassert>
+#include <memory>
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+#include "allocator.h"
+#include "statistics.h"
+#include "instrumentation.h"
+#include "splay_tree.h"
+
+// Sequence (rope) on a splay tree keyed implicitly by position, as the
+// link cut tree and euler tree keep their paths and tours.
+// Every edit and range query costs amortized O(log n).
+// Reverse is lazy, so Stat should be commutative (as for an evertable
+// link cut tree). Instr is an instrumentation policy (instrumentation.h)
+template <class T, class Stat = EmptyStatistic, class Alloc = PoolAllocator,
+	class Instr = NoInstrumentation>
+class SplaySequence {
+public:
+	struct Node : BasicTreeNode <Node> {
+		T key;
+		Stat stat;
+		size_t n; // nodes in the splay subtree
+		bool reverse; // the subtree is to be mirrored
+		Node (const T& key, Node *p = NULL, Node *l = NULL, Node *r = NULL)
+			: BasicTreeNode<Node>(p,l,r), key(key), n(1), reverse(false) {}
+
+		void Update() {
+			stat.Init(key);
+			n = 1;
+			if (this->Left()) stat.UpdateLeft(this->Left()->stat), n += this->Left()->n;
+			if (this->Right()) stat.UpdateRight(this->Right()->stat), n += this->Right()->n;
+		}
+	};
+
+private:
+	struct FalseComp {
+		bool operator()(const T& l, const T& r) const {
+			return false;
+		}
+	};
+
+	typedef SplayTreeBase<T, Node, FalseComp, Instr> ST;
+	typedef typename Alloc::template Pool<Node> NodePool;
+
+public:
+	SplaySequence() : root(NULL), pool(std::make_shared<NodePool>()) {}
+	SplaySequence(const SplaySequence &) = delete;
+	~SplaySequence() { Clear(); }
+
+	size_t Size() const { return root?root->n:0; }
+
+	// Erase every element. O(#slabs) unless the pool is shared since a Split
+	void Clear() {
+		if (pool.use_count() == 1) {
+			Instr::Freed(pool->Size() * sizeof(Node));
+			pool->Clear();
+		} else DestroyTree(root);
+		root = NULL;
+	}
+
+	// x becomes the element at position i (i <= Size())
+	void InsertAt(size_t i, const T& x) {
+		assert(i <= Size());
+		Node *l, *r;
+		SplitAt(root, i, l, r);
+		root = Concat(l, ST::CreateNode(*pool, x), r);
+	}
+
+	void PushBack(const T& x) { InsertAt(Size(), x); }
+
+	void EraseAt(size_t i) {
+		assert(i < Size());
+		Node *l, *m, *r;
+		SplitAt(root, i, l, r);
+		SplitAt(r, 1, m, r);
+		ST::DestroyNode(*pool, m);
+		root = Concat(l, r);
+	}
+
+	const T& At(size_t i) {
+		assert(i < Size());
+		return (root = Select(root, i))->key;
+	}
+
+	void Set(size_t i, const T& x) {
+		assert(i < Size());
+		root = Select(root, i);
+		root->key = x;
+		ST::Update(root);
+	}
+
+	// Move the elements from position i on to the empty sequence right.
+	// Both draw nodes from the same pool afterwards (it lives as long as
+	// either), so keep them on one thread
+	void Split(size_t i, SplaySequence &right) {
+		assert(&right != this && !right.root && i <= Size());
+		SplitAt(root, i, root, right.root);
+		right.pool = pool;
+	}
+
+	// Append the elements of right, leaving it empty. A pool of right not
+	// shared with another sequence is adopted in O(#slabs), the nodes of
+	// one still shared are copied in O(m)
+	void Concat(SplaySequence &right) {
+		assert(&right != this);
+		if (!right.root) return;
+		Node *r = right.root;
+		if (right.pool != pool) {
+			if (right.pool.use_count() == 1) pool->Adopt(*right.pool);
+			else {
+				std::vector<Node *> nodes;
+				right.InOrder([&](Node *x) { nodes.push_back(x); });
+				for (size_t i = 0 ; i < nodes.size() ; ++i) nodes[i] = ST::CreateNode(*pool, nodes[i]->key);
+				right.Clear();
+				r = ST::BuildBalanced(nodes.data(), nodes.data() + nodes.size());
+			}
+		}
+		right.root = NULL;
+		root = Concat(root, r);
+	}
+
+	// Reverse positions [l, r)
+	void Reverse(size_t l, size_t r) {
+		assert(l <= r && r <= Size());
+		if (r - l < 2) return;
+		Node *a, *m, *b;
+		SplitAt(root, r, m, b);
+		SplitAt(m, l, a, m);
+		m->reverse ^= 1;
+		root = Concat(Concat(a, m), b);
+	}
+
+	// Statistic on positions [l, r)
+	Stat RangeStatistic(size_t l, size_t r) {
+		assert(l <= r && r <= Size());
+		if (l == r) return Stat();
+		Node *a, *m, *b;
+		SplitAt(root, r, m, b);
+		SplitAt(m, l, a, m);
+		Stat ret = m->stat;
+		root = Concat(Concat(a, m), b);
+		return ret;
+	}
+
+	// Call fn(element) in order. Pending reverses are pushed down on the
+	// way, nothing is splayed
+	template <class Fn>
+	void ForEach(Fn fn) {
+		InOrder([&](Node *x) { fn(x->key); });
+	}
+
+	// Counters of the instrumentation policy
+	static InstrumentationStats Stats() {
+		return Instr::Stats();
+	}
+
+private:
+	void Push(Node *x) {
+		if (!x->reverse) return;
+		Instr::ReversePush();
+		std::swap(x->l, x->r);
+		if (x->l) x->l->reverse ^= 1;
+		if (x->r) x->r->reverse ^= 1;
+		x->reverse = false;
+	}
+
+	// Node at position i under the detached root t, splayed to its top.
+	// Reverses on the way are pushed down first so that rotations see
+	// the real order
+	Node *Select(Node *t, size_t i) {
+		assert(t && i < t->n);
+		for (;;) {
+			Push(t);
+			size_t left = t->Left()?t->Left()->n:0;
+			if (i == left) break;
+			if (i < left) t = t->Left();
+			else i -= left + 1, t = t->Right();
+		}
+		ST::SplayNode(t);
+		return t;
+	}
+
+	// The first i elements of t and the rest, each detached
+	void SplitAt(Node *t, size_t i, Node *&l, Node *&r) {
+		if (!t || i >= t->n) { l = t, r = NULL; return; }
+		r = Select(t, i);
+		l = r->Left();
+		if (l) l->Parent() = NULL;
+		r->Left() = NULL;
+		ST::Update(r);
+	}
+
+	Node *Concat(Node *l, Node *r) {
+		if (!l) return r;
+		if (!r) return l;
+		l = Select(l, l->n - 1);
+		l->Right() = r, r->Parent() = l;
+		ST::Update(l);
+		return l;
+	}
+
+	// l, then the single node m, then r
+	static Node *Concat(Node *l, Node *m, Node *r) {
+		m->Parent() = NULL, m->Left() = l, m->Right() = r;
+		if (l) l->Parent() = m;
+		if (r) r->Parent() = m;
+		ST::Update(m);
+		return m;
+	}
+
+	// fn(node) in order, reverses pushed on the way
+	template <class Fn>
+	void InOrder(Fn fn) {
+		std::vector<Node *> stack;
+		for (Node *t = root ; t || !stack.empty() ;) {
+			for (; t ; t = t->Left()) Push(t), stack.push_back(t);
+			t = stack.back();
+			stack.pop_back();
+			fn(t);
+			t = t->Right();
+		}
+	}
+
+	void DestroyTree(Node *t) {
+		std::vector<Node *> stack;
+		if (t) stack.push_back(t);
+		while (!stack.empty()) {
+			t = stack.back();
+			stack.pop_back();
+			if (t->Left()) stack.push_back(t->Left());
+			if (t->Right()) stack.push_back(t->Right());
+			ST::DestroyNode(*pool, t);
+		}
+	}
+
+	Node *root;
+	// Shared by the sequences a Split made
+	std::shared_ptr<NodePool> pool;
+};
+
+#endif
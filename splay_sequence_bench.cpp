@@ -0,0 +1,61 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+#include <cstdlib>
+#include <chrono>
+
+#include "statistics.h"
+#include "splay_sequence.h"
+
+using namespace std;
+
+typedef SplaySequence<size_t, SumStatistic<size_t> > Sequence;
+typedef chrono::steady_clock Clock;
+
+double ms_since(Clock::time_point t0) {
+	return chrono::duration<double, milli>(Clock::now() - t0).count();
+}
+
+// Edits at random positions of a sequence of n elements: inserts,
+// erases, and reverses and sums of up to n / 10 elements, against a vector
+int main(int argc, const char *argv[])
+{
+	size_t n = argc > 1?atol(argv[1]):1000000, ops = 10000;
+	srand(1);
+	vector<size_t> pos(ops), len(ops);
+	for (size_t i = 0 ; i < ops ; ++i) pos[i] = rand() % (n / 2), len[i] = rand() % (n / 10);
+	cout << ops << " edits on a sequence of " << n << endl;
+
+	Sequence seq;
+	for (size_t i = 0 ; i < n ; ++i) seq.PushBack(i);
+	vector<size_t> v(n);
+	for (size_t i = 0 ; i < n ; ++i) v[i] = i;
+	size_t check = 0;
+	const char *names[] = { "InsertAt", "EraseAt", "Reverse", "RangeStatistic" };
+	for (int op = 0 ; op < 4 ; ++op) {
+		Clock::time_point t0 = Clock::now();
+		for (size_t i = 0 ; i < ops ; ++i) {
+			switch (op) {
+				case 0: seq.InsertAt(pos[i], i); break;
+				case 1: seq.EraseAt(pos[i]); break;
+				case 2: seq.Reverse(pos[i], pos[i] + len[i]); break;
+				case 3: check += seq.RangeStatistic(pos[i], pos[i] + len[i]).sum; break;
+			}
+		}
+		double rope = ms_since(t0);
+		t0 = Clock::now();
+		for (size_t i = 0 ; i < ops ; ++i) {
+			switch (op) {
+				case 0: v.insert(v.begin() + pos[i], i); break;
+				case 1: v.erase(v.begin() + pos[i]); break;
+				case 2: reverse(v.begin() + pos[i], v.begin() + pos[i] + len[i]); break;
+				case 3: for (size_t j = pos[i] ; j < pos[i] + len[i] ; ++j) check -= v[j]; break;
+			}
+		}
+		cout << "  " << left << setw(16) << names[op] << right << setw(10) << rope << " ms   vector"
+			<< setw(10) << ms_since(t0) << " ms" << endl;
+	}
+	if (check) cout << "  (mismatch)" << endl;
+	return 0;
+}
@@ -0,0 +1,96 @@
+#include <iostream>
+#include <vector>
+#include <cstdlib>
+#include <cassert>
+#include <algorithm>
+#include <numeric>
+
+#include "statistics.h"
+#include "splay_sequence.h"
+
+using namespace std;
+
+typedef SplaySequence<long, SumStatistic<long> > Sequence;
+
+void check(Sequence &seq, const vector<long> &v) {
+	assert(seq.Size() == v.size());
+	vector<long> got;
+	seq.ForEach([&](long x) { got.push_back(x); });
+	assert(got == v);
+}
+
+// Random edits, reverses and range queries against a vector
+void splay_sequence_test(size_t N) {
+	Sequence seq;
+	vector<long> v;
+	for (size_t k = 0 ; k < 20 * N ; ++k) {
+		size_t n = v.size(), i = rand() % (n + 1), j = rand() % (n + 1);
+		if (i > j) swap(i, j);
+		switch (rand() % 6) {
+			case 0: case 1: {
+				long x = rand() % 1000;
+				seq.InsertAt(i, x), v.insert(v.begin() + i, x);
+				break;
+			}
+			case 2:
+				if (i < n) seq.EraseAt(i), v.erase(v.begin() + i);
+				break;
+			case 3:
+				seq.Reverse(i, j), reverse(v.begin() + i, v.begin() + j);
+				break;
+			case 4:
+				assert(seq.RangeStatistic(i, j).sum == accumulate(v.begin() + i, v.begin() + j, 0L));
+				break;
+			case 5:
+				if (i < n) {
+					assert(seq.At(i) == v[i]);
+					seq.Set(i, v[i] + 1), ++v[i];
+				}
+				break;
+		}
+	}
+	check(seq, v);
+	std::cout << "Sequence Done" << std::endl;
+}
+
+void splay_sequence_split_test(size_t N) {
+	vector<long> v;
+	Sequence *seq = new Sequence;
+	for (size_t i = 0 ; i < N ; ++i) seq->PushBack(i), v.push_back(i);
+	seq->Reverse(N / 4, 3 * N / 4), reverse(v.begin() + N / 4, v.begin() + 3 * N / 4);
+
+	// Cut in three with reverses pending, drop the first one
+	Sequence mid, right;
+	seq->Split(N / 3, mid);
+	mid.Split(N / 3, right);
+	vector<long> a(v.begin(), v.begin() + N / 3), b(v.begin() + N / 3, v.begin() + 2 * N / 3), c(v.begin() + 2 * N / 3, v.end());
+	check(*seq, a);
+	delete seq;
+	mid.Reverse(0, mid.Size()), reverse(b.begin(), b.end());
+	check(mid, b);
+	check(right, c);
+
+	// Back together, then with a separate sequence and with one sharing
+	// its pool elsewhere
+	right.Concat(mid);
+	c.insert(c.end(), b.begin(), b.end());
+	check(right, c);
+	check(mid, vector<long>());
+	Sequence other, shared;
+	for (size_t i = 0 ; i < N ; ++i) other.PushBack(-long(i));
+	other.Split(N / 2, shared);
+	right.Concat(other);
+	right.Concat(shared);
+	for (size_t i = 0 ; i < N ; ++i) c.push_back(-long(i));
+	check(right, c);
+	check(other, vector<long>());
+	assert(right.RangeStatistic(0, right.Size()).sum == accumulate(c.begin(), c.end(), 0L));
+	std::cout << "Split Concat Done" << std::endl;
+}
+
+int main(int argc, const char *argv[])
+{
+	splay_sequence_test(1000);
+	splay_sequence_split_test(3000);
+	return 0;
+}
@@ -2,16 +2,26 @@
 #define __SPRAY_TREE_H__
 
 #include <cassert>
-#include <unordered_set>
+#include <memory>
+#include <vector>
+#include <iterator>
+#include <algorithm>
+#include <functional>
+
+#include "allocator.h"
+#include "statistics.h"
+#include "navigator.h"
+#include "instrumentation.h"
 
 // TODO: Insert multiple elements of same value..
 
 template <class Node>
 struct BasicTreeNode {
+	// Set by nodes whose Update() does nothing, so that splaying skips it
+	enum { TRIVIAL_UPDATE = false };
 	Node *p, *l, *r;
 	BasicTreeNode (Node *p = NULL, Node *l = NULL,  Node *r = NULL)
 		: p(p), l(l), r(r) {}
-	~BasicTreeNode() { delete l, delete r; }
 	Node *&Parent() { return p; }
 	Node *&Left() { return l; }
 	Node *&Right() { return r; }
@@ -24,6 +34,7 @@ struct BasicTreeNode {
 template <class T, class ST>
 struct SplayNode : BasicTreeNode < SplayNode<T, ST> > {
 	typedef ST Statistic;
+	enum { TRIVIAL_UPDATE = IsTrivialStatistic<ST>::value };
 	T key;
 	ST stat;
 	SplayNode (const T &key, SplayNode<T,ST> *p = NULL, SplayNode<T,ST> *l = NULL, SplayNode<T,ST> *r = NULL)
@@ -36,7 +47,8 @@ struct SplayNode : BasicTreeNode < SplayNode<T, ST> > {
 	}
 };
 
-template < class T, class Node, class Comp >
+// Instr is an instrumentation policy (instrumentation.h)
+template < class T, class Node, class Comp, class Instr = NoInstrumentation >
 class SplayTreeBase {
 public:
 	// ***************************************************
@@ -44,16 +56,21 @@ public:
 	// ***************************************************
 	// Functions need to be accessed only by link cut tree
 	// Splay a node to the root (but not setting to root)
+	// Each rotation recomputes only the node it moves down, x is
+	// recomputed once at the end. Nodes above x keep the same subtree.
 	static void SplayNode(Node* x) {
-		if (!x) return;
+		if (!x || IsRoot(x)) return;
+		size_t depth = 0;
 		while (!IsRoot(x)) {
 			Node* y = x->Parent();
-			if (IsRoot(y)) Rotate(x);
+			if (IsRoot(y)) RotateUp(x), depth += 1;
 			else if ((y->Parent()->Left() == y && x == y->Left())
 					||(y->Parent()->Right() == y && x == y->Right()))
-				Rotate(y), Rotate(x);
-			else Rotate(x), Rotate(x);
+				RotateUp(y), RotateUp(x), depth += 2;
+			else RotateUp(x), RotateUp(x), depth += 2;
 		} 
+		Update(x);
+		Instr::Splay(depth);
 	}
 
 	static bool IsRoot(const Node* x) {
@@ -63,13 +80,20 @@ public:
 
 	// Recompute information in a node (if needed)
 	static void Update(Node* x) {
-		if (!x) return;
+		if (Node::TRIVIAL_UPDATE || !x) return;
 		x->Update();
 	}
 
 	// Rotate x one level up
 	static void Rotate(Node* x) {
 		if (IsRoot(x)) return;
+		RotateUp(x);
+		Update(x);
+	}
+
+	// Rotate x one level up, recomputing only the old parent
+	static void RotateUp(Node* x) {
+		Instr::Rotation();
 		Node* y = x->Parent();
 		x->Parent() = y->Parent();
 		if (!IsRoot(y)) (y->Parent()->Left()==y)?(y->Parent()->Left()=x):(y->Parent()->Right()=x);
@@ -83,18 +107,38 @@ public:
 		}
 		assert(!(x->Left()) || !Comp()(x->key, x->Left()->key)); 
 		assert(!(x->Right()) || !Comp()(x->Right()->key, x->key));
-		// TODO: better update strategy?
-		Update(y), Update(x);
-		if (!IsRoot(x)) Update(x->Parent());
+		Update(y);
 	}
 
-	static Node* CreateNode(const T& x, Node* p = NULL, Node* l = NULL, Node* r = NULL) {
-		Node *node = new Node(x,p,l,r);
+	// Nodes are owned by the pool of the calling structure
+	template <class Pool>
+	static Node* CreateNode(Pool &pool, const T& x, Node* p = NULL, Node* l = NULL, Node* r = NULL) {
+		Node *node = pool.Create(x,p,l,r);
 		node->stat.Add();
 		node->Update();
+		Instr::Allocated(sizeof(Node));
 		return node;
 	}
 
+	template <class Pool>
+	static void DestroyNode(Pool &pool, Node *node) {
+		Instr::Freed(sizeof(Node));
+		pool.Destroy(node);
+	}
+
+	// Link nodes [begin, end) into a balanced tree keeping their order
+	// and compute statistics bottom-up. Returns the root (parent p)
+	static Node *BuildBalanced(Node *const *begin, Node *const *end, Node *p = NULL) {
+		if (begin == end) return NULL;
+		Node *const *mid = begin + (end - begin) / 2;
+		Node *x = *mid;
+		x->Parent() = p;
+		x->Left() = BuildBalanced(begin, mid, x);
+		x->Right() = BuildBalanced(mid + 1, end, x);
+		Update(x);
+		return x;
+	}
+
 	static Node *Pred(Node *x) {
 		SplayNode(x);
 		if (!x->Left()) return NULL;
@@ -127,25 +171,27 @@ public:
 	}
 };
 
-template < class T, class ST, class Node = SplayNode<T, ST>, class Comp = std::less<T> >
-class SplayTree : public SplayTreeBase<T, Node, Comp> {
+template < class T, class ST, class Node = SplayNode<T, ST>, class Comp = std::less<T>,
+	class Alloc = PoolAllocator, class Instr = NoInstrumentation >
+class SplayTree : public SplayTreeBase<T, Node, Comp, Instr> {
 public:
-	typedef SplayTreeBase<T, Node, Comp> STBase;
+	typedef SplayTreeBase<T, Node, Comp, Instr> STBase;
+	typedef typename Alloc::template Pool<Node> NodePool;
 
 	// *******************************************
 	// Basic interfaces for basic splay tree usage
 	// *******************************************
 	// Construct an empty splay tree
-	SplayTree() : root(NULL) {}
-	// Disassemble the tree
-	~SplayTree() { delete root; }
+	SplayTree() : root(NULL), pool(std::make_shared<NodePool>()) {}
+	SplayTree(const SplayTree &) = delete;
+	~SplayTree() { Clear(); }
 
 	// Insert key x in the tree
 	void Insert(const T&x) {
-		if (!root) { root = STBase::CreateNode(x); Splay(root); return; }
+		if (!root) { root = STBase::CreateNode(*pool, x); Splay(root); return; }
 		Node* cur = Search(x);
-		if (Comp()(x, cur->key)) cur->Left() = STBase::CreateNode(x, cur), Splay(cur->Left());
-		else if (Comp()(cur->key, x)) cur->Right() = STBase::CreateNode(x, cur), Splay(cur->Right());
+		if (Comp()(x, cur->key)) cur->Left() = STBase::CreateNode(*pool, x, cur), Splay(cur->Left());
+		else if (Comp()(cur->key, x)) cur->Right() = STBase::CreateNode(*pool, x, cur), Splay(cur->Right());
 		else cur->stat.Add(), Splay(cur);
 	}
 
@@ -168,8 +214,188 @@ public:
 		}
 		if (root) root->Parent() = NULL, STBase::Update(root->Left()), STBase::Update(root->Right());
 		STBase::Update(root);
-		tmp->Left() = tmp->Right() = NULL;
-		delete tmp;
+		STBase::DestroyNode(*pool, tmp);
+	}
+
+	// Build an empty tree from keys sorted by Comp in O(n).
+	// Equal keys share one node (stat.cnt), and the tree comes out
+	// balanced instead of the path repeated Insert would leave.
+	template <class It>
+	void BuildFromSorted(It begin, It end) {
+		assert(!root);
+		root = BuildRun(begin, end, Distinct(begin, end), NULL);
+	}
+
+	// Insert keys sorted by Comp (random access iterators). The batch is
+	// split along the tree top-down: each node visited takes its equal
+	// keys and hands the smaller and larger ones to its children, and a
+	// run reaching an empty child becomes a balanced subtree there. No
+	// node is splayed or visited twice, so it costs O(k log(n / k)) on a
+	// balanced tree and never more than O(n + k).
+	template <class It>
+	void InsertSorted(It begin, It end) {
+		if (begin == end) return;
+		if (!root) return BuildFromSorted(begin, end);
+		// Nodes to visit with their keys, then update on the way back
+		struct Frame {
+			Node *x;
+			It lo, hi;
+			bool update;
+		};
+		std::vector<Frame> stack;
+		Frame top = { root, begin, end, false };
+		stack.push_back(top);
+		while (!stack.empty()) {
+			Frame f = stack.back();
+			stack.pop_back();
+			Node *x = f.x;
+			if (f.update) { STBase::Update(x); continue; }
+			It l = std::lower_bound(f.lo, f.hi, x->key, Comp()), r = std::upper_bound(l, f.hi, x->key, Comp());
+			for (It i = l ; i != r ; ++i) x->stat.Add();
+			Frame up = { x, f.lo, f.lo, true };
+			stack.push_back(up);
+			for (int side = 0 ; side < 2 ; ++side) {
+				It lo = side?r:f.lo, hi = side?f.hi:l;
+				Node *&child = side?x->Right():x->Left();
+				if (lo == hi) continue;
+				if (child) {
+					Frame down = { child, lo, hi, false };
+					stack.push_back(down);
+					continue;
+				}
+				child = BuildRun(lo, hi, Distinct(lo, hi), x);
+			}
+		}
+	}
+
+	// Erase every key. O(#slabs) unless the pool is shared since a Split
+	void Clear() {
+		if (pool.use_count() == 1) {
+			Instr::Freed(pool->Size() * sizeof(Node));
+			pool->Clear();
+		} else DestroyTree(root);
+		root = NULL;
+	}
+
+	// ******************************
+	// Split, Join and set operations
+	// ******************************
+	// Move the keys not before x to the empty tree right.
+	// Both trees draw nodes from the same pool afterwards (it lives as
+	// long as either), so keep them on one thread. Amortized O(log n)
+	void Split(const T& x, SplayTree &right) {
+		assert(&right != this && !right.root);
+		Node *e, *r;
+		Divide(root, x, root, e, r);
+		right.root = e?Concat(NULL, e, r):r;
+		right.pool = pool;
+	}
+
+	// Append the keys of right, all after those of this tree, leaving
+	// right empty. Amortized O(log n) after a Split; a pool of right not
+	// shared with another tree is adopted in O(#slabs), and the nodes of
+	// one still shared are copied in O(m)
+	void Join(SplayTree &right) {
+		assert(&right != this);
+		if (!right.root) return;
+		Node *r = right.root;
+		if (right.pool != pool) {
+			if (right.pool.use_count() == 1) pool->Adopt(*right.pool);
+			else {
+				std::vector<Node *> nodes;
+				Flatten(r, nodes);
+				for (size_t i = 0 ; i < nodes.size() ; ++i) {
+					Node *copy = STBase::CreateNode(*pool, nodes[i]->key);
+					copy->stat = nodes[i]->stat;
+					nodes[i] = copy;
+				}
+				right.Clear();
+				r = STBase::BuildBalanced(nodes.data(), nodes.data() + nodes.size());
+			}
+		}
+		right.root = NULL;
+		root = Concat(root, r);
+		assert(!root->Right() || Comp()(root->key, Min(root->Right())->key));
+	}
+
+	// Erase every key in [lo, hi). Amortized O(log n + erased)
+	void EraseRange(const T& lo, const T& hi) {
+		if (!Comp()(lo, hi)) return;
+		Node *l, *e, *m, *r;
+		Divide(root, lo, l, e, r);
+		Divide(e?Concat(NULL, e, r):r, hi, m, e, r);
+		DestroyTree(m);
+		root = Concat(l, e?Concat(NULL, e, r):r);
+	}
+
+	// Multiset operations with the keys of other, in place. Duplicate
+	// counts (stat.cnt) add up for Union, take the minimum for
+	// Intersection and subtract for Difference.
+	// A few keys divide the tree recursively: at the middle key of other,
+	// each half going on with the keys on its side, and the results are
+	// concatenated through the node of that key, so each divide searches
+	// only the part of the tree its keys can land in. Many keys merge both
+	// trees in order and rebuild balanced in O(n + m).
+	void Union(const SplayTree &other) { SetOperation(other, UNION); }
+
+	void Intersection(const SplayTree &other) { SetOperation(other, INTERSECTION); }
+
+	void Difference(const SplayTree &other) { SetOperation(other, DIFFERENCE); }
+
+	// *********************
+	// Iterators and scans
+	// *********************
+	// In-order over the distinct keys, duplicates are counted in
+	// Stat().cnt. Iterators follow the links without splaying, so a scan
+	// is linear, and they stay valid while other keys come and go
+	class const_iterator {
+	public:
+		typedef std::bidirectional_iterator_tag iterator_category;
+		typedef T value_type;
+		typedef std::ptrdiff_t difference_type;
+		typedef const T *pointer;
+		typedef const T &reference;
+
+		const_iterator() : x(NULL), tree(NULL) {}
+
+		reference operator*() const { return x->key; }
+		pointer operator->() const { return &x->key; }
+		const ST &Stat() const { return x->stat; }
+
+		const_iterator &operator++() { x = Next(x); return *this; }
+		const_iterator &operator--() { x = x?Prev(x):Max(tree->root); return *this; }
+		const_iterator operator++(int) { const_iterator ret = *this; ++*this; return ret; }
+		const_iterator operator--(int) { const_iterator ret = *this; --*this; return ret; }
+
+		bool operator==(const const_iterator &o) const { return x == o.x; }
+		bool operator!=(const const_iterator &o) const { return x != o.x; }
+
+	private:
+		friend class SplayTree;
+		const_iterator(const Node *x, const SplayTree *tree) : x(x), tree(tree) {}
+		const Node *x;
+		const SplayTree *tree;
+	};
+	typedef const_iterator iterator;
+	typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+	typedef const_reverse_iterator reverse_iterator;
+
+	const_iterator begin() const { return const_iterator(root?Min(root):NULL, this); }
+	const_iterator end() const { return const_iterator(NULL, this); }
+	const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+	const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+
+	// Call fn(key, stat) on each distinct key in [lo, hi) in order.
+	// O(depth + keys visited), nothing is splayed
+	template <class Fn>
+	void ForEachInRange(const T& lo, const T& hi, Fn fn) const {
+		for (const Node *x = LowerBoundNode(lo) ; x && Comp()(x->key, hi) ; x = Next(x))
+			fn(x->key, x->stat);
+	}
+
+	// Counters of the instrumentation policy
+	static InstrumentationStats Stats() {
+		return Instr::Stats();
 	}
 
 	// *******************
@@ -195,10 +421,40 @@ public:
 		return ret;
 	}
 
+	// Statistic on the keys in [lo, hi). The last key before lo is
+	// splayed to the root and the first one from hi to just below it,
+	// which leaves the range alone in one subtree
+	ST RangeStatistic(const T& lo, const T& hi) {
+		Node *range = IsolateRange(lo, hi);
+		return range?range->stat:ST();
+	}
+
+	// Keys in [lo, hi), duplicates included.
+	// For statistics counting the subtree size (ss)
+	size_t CountInRange(const T& lo, const T& hi) {
+		return RangeStatistic(lo, hi).ss;
+	}
+
+	// Keys before x, duplicates included (ss as above)
+	size_t Rank(const T& x) {
+		Node *before, *from, *last;
+		Descend(root, x, false, before, from, last);
+		if (!root) return 0;
+		Splay(from?from:last);
+		if (!from) return root->stat.ss;
+		return root->Left()?root->Left()->stat.ss:0;
+	}
+
+	// First key not before x and first key after x, splayed to the root
+	const_iterator LowerBound(const T& x) { return Bound(x, false); }
+
+	const_iterator UpperBound(const T& x) { return Bound(x, true); }
+
 	// According to given navigator
 	// it follows the tree and makes a new statistic
 	template<class Navigator>
 	T Find(Navigator nav, const T & empty = T()) {
+		static_assert(std::is_base_of<NavigatorBasic, Navigator>::value, "navigators derive from NavigatorBasic");
 		if (!root) return empty;
 		Node* cur = root;
 		nav.Init();
@@ -253,6 +509,7 @@ public:
 	// that is, caller should manage splaynode(f) at some point
 	template <class Navigator>
 	static Node * NavigatorSearch(Navigator nav, Node *f, Node *t) {
+		static_assert(std::is_base_of<NavigatorBasic, Navigator>::value, "navigators derive from NavigatorBasic");
 		STBase::SplayNode(t);
 		Node * cur = f;
 		nav.Init();
@@ -290,7 +547,339 @@ private:
 		root = x;
 	}
 
+	// Keys of a sorted range that differ from the one before
+	template <class It>
+	static size_t Distinct(It begin, It end) {
+		size_t n = 0;
+		for (It prev = begin ; begin != end ; prev = begin++)
+			if (prev == begin || Comp()(*prev, *begin)) ++n;
+			else assert(!Comp()(*begin, *prev)); // sorted
+		return n;
+	}
+
+	// Balanced tree over the next n distinct keys from cur, built in order
+	// in one pass so that each node is linked while it is still cached.
+	// Equal keys count in the stat of one node.
+	template <class It>
+	Node *BuildRun(It &cur, It end, size_t n, Node *p) {
+		if (!n) return NULL;
+		Node *left = BuildRun(cur, end, n / 2, NULL);
+		Node *x = STBase::CreateNode(*pool, *cur, p, left);
+		if (left) left->Parent() = x;
+		for (++cur ; cur != end && !Comp()(x->key, *cur) ; ++cur) x->stat.Add();
+		x->Right() = BuildRun(cur, end, n - n / 2 - 1, x);
+		STBase::Update(x);
+		return x;
+	}
+
+	// Under t, the last node before x and the first one not before x (or
+	// not after and after x when upper), with the last node visited
+	static void Descend(Node *t, const T& x, bool upper, Node *&before, Node *&from, Node *&last) {
+		before = from = last = NULL;
+		while (t) {
+			last = t;
+			if (upper?!Comp()(x, t->key):Comp()(t->key, x)) before = t, t = t->Right();
+			else from = t, t = t->Left();
+		}
+	}
+
+	const_iterator Bound(const T& x, bool upper) {
+		Node *before, *from, *last;
+		Descend(root, x, upper, before, from, last);
+		Splay(from?from:last);
+		return const_iterator(from, this);
+	}
+
+	// Root of the subtree holding the keys in [lo, hi) after two splays
+	Node *IsolateRange(const T& lo, const T& hi) {
+		if (!root || !Comp()(lo, hi)) return NULL;
+		Node *a, *b, *last;
+		Descend(root, lo, false, a, b, last);
+		Splay(a?a:last);
+		Node *region = a?a->Right():root;
+		if (!region) return NULL;
+		// The keys from lo on are splayed apart from a, then put back
+		region->Parent() = NULL;
+		Node *before;
+		Descend(region, hi, false, before, b, last);
+		region = b?b:last;
+		STBase::SplayNode(region);
+		if (a) a->Right() = region, region->Parent() = a, STBase::Update(a);
+		else root = region;
+		return b?b->Left():region;
+	}
+
+	// Split the tree under the root t at x into the keys before x, the
+	// node of x (if any) and the keys after x, each detached
+	static void Divide(Node *t, const T& x, Node *&l, Node *&e, Node *&r) {
+		l = e = r = NULL;
+		if (!t) return;
+		for (Node *cur = t ; cur ;) {
+			t = cur;
+			if (Comp()(x, cur->key)) cur = cur->Left();
+			else if (Comp()(cur->key, x)) cur = cur->Right();
+			else break;
+		}
+		STBase::SplayNode(t);
+		if (Comp()(x, t->key)) r = t, l = Detach(t->Left());
+		else if (Comp()(t->key, x)) l = t, r = Detach(t->Right());
+		else e = t, l = Detach(t->Left()), r = Detach(t->Right());
+		STBase::Update(t);
+	}
+
+	// Null the link to child x, whose parent link is cleared
+	static Node *Detach(Node *&x) {
+		Node *ret = x;
+		if (ret) ret->Parent() = NULL;
+		x = NULL;
+		return ret;
+	}
+
+	// Roots l and r with every key of l before those of r
+	static Node *Concat(Node *l, Node *r) {
+		if (!l) return r;
+		if (!r) return l;
+		while (l->Right()) l = l->Right();
+		STBase::SplayNode(l);
+		l->Right() = r, r->Parent() = l;
+		STBase::Update(l);
+		return l;
+	}
+
+	// l, then the single node m, then r
+	static Node *Concat(Node *l, Node *m, Node *r) {
+		m->Parent() = NULL, m->Left() = l, m->Right() = r;
+		if (l) l->Parent() = m;
+		if (r) r->Parent() = m;
+		STBase::Update(m);
+		return m;
+	}
+
+	// Right children on the way are fetched ahead for the walks
+	static const Node *Min(const Node *x) {
+		for (; x->Left() ; x = x->Left()) Prefetch(x->Right());
+		return x;
+	}
+
+	static const Node *Max(const Node *x) {
+		while (x->Right()) x = x->Right();
+		return x;
+	}
+
+	static void Prefetch(const Node *x) {
+#ifdef __GNUC__
+		__builtin_prefetch(x);
+#endif
+	}
+
+	// In-order neighbours through the parent links
+	static const Node *Next(const Node *x) {
+		if (x->Right()) return Min(x->Right());
+		while (x->Parent() && x->Parent()->Right() == x) x = x->Parent();
+		return x->Parent();
+	}
+
+	static const Node *Prev(const Node *x) {
+		if (x->Left()) return Max(x->Left());
+		while (x->Parent() && x->Parent()->Left() == x) x = x->Parent();
+		return x->Parent();
+	}
+
+	// First node not before x, without splaying
+	const Node *LowerBoundNode(const T& x) const {
+		const Node *ret = NULL;
+		for (const Node *cur = root ; cur ;) {
+			if (Comp()(cur->key, x)) cur = cur->Right();
+			else ret = cur, cur = cur->Left();
+		}
+		return ret;
+	}
+
+	// Nodes under t in order, without splaying
+	static void Flatten(Node *t, std::vector<Node *> &out) {
+		std::vector<Node *> stack;
+		while (t || !stack.empty()) {
+			for (; t ; t = t->Left()) stack.push_back(t);
+			t = stack.back();
+			stack.pop_back();
+			out.push_back(t);
+			t = t->Right();
+		}
+	}
+
+	// Nodes under t, counted up to limit. The pool may be shared with
+	// other trees, so its size says nothing about this one
+	static size_t CountUpTo(Node *t, size_t limit) {
+		std::vector<Node *> stack;
+		if (t) stack.push_back(t);
+		size_t count = 0;
+		while (!stack.empty() && count < limit) {
+			t = stack.back();
+			stack.pop_back();
+			++count;
+			if (t->Left()) stack.push_back(t->Left());
+			if (t->Right()) stack.push_back(t->Right());
+		}
+		return count;
+	}
+
+	void DestroyTree(Node *t) {
+		std::vector<Node *> stack;
+		if (t) stack.push_back(t);
+		while (!stack.empty()) {
+			t = stack.back();
+			stack.pop_back();
+			if (t->Left()) stack.push_back(t->Left());
+			if (t->Right()) stack.push_back(t->Right());
+			STBase::DestroyNode(*pool, t);
+		}
+	}
+
+	enum SetOp { UNION, INTERSECTION, DIFFERENCE };
+
+	// A linear merge of both trees, unless this tree has more than 8 times
+	// as many nodes as other: then the keys of other go in as per-key runs
+	// (CountUpTo stops counting there)
+	void SetOperation(const SplayTree &other, SetOp op) {
+		std::vector<Node *> keys;
+		Flatten(other.root, keys);
+		Node *const *lo = keys.data(), *const *hi = lo + keys.size();
+		size_t limit = keys.size() * 8 + 1;
+		if (CountUpTo(root, limit) < limit) root = MergeRun(lo, hi, op);
+		else if (op == UNION) root = UnionRun(root, lo, hi);
+		else if (op == INTERSECTION) root = IntersectionRun(root, lo, hi);
+		else root = DifferenceRun(root, lo, hi);
+	}
+
+	// Nodes of this tree in order, merged with the keys of other (which
+	// may be this tree), equal keys combined into the node of this tree.
+	// Nodes are relinked as they stream out of the traversal, each while
+	// it is still cached; the traversal reads a right child before
+	// giving its node away
+	Node *MergeRun(Node *const *lo, Node *const *hi, SetOp op) {
+		std::vector<Node *> stack;
+		Builder out;
+		Node *t = root, *a = NULL;
+		for (;;) {
+			if (!a) {
+				for (; t ; t = t->Left()) stack.push_back(t), Prefetch(t->Right());
+				if (!stack.empty()) a = stack.back(), stack.pop_back(), t = a->Right();
+			}
+			if (!a && lo == hi) break;
+			if (lo == hi || (a && Comp()(a->key, (*lo)->key))) {
+				if (op == INTERSECTION) STBase::DestroyNode(*pool, a);
+				else out.Add(a);
+			} else if (!a || Comp()((*lo)->key, a->key)) {
+				if (op == UNION) {
+					Node *x = STBase::CreateNode(*pool, (*lo)->key);
+					x->stat.cnt = (*lo)->stat.cnt;
+					out.Add(x);
+				}
+				++lo;
+				continue;
+			} else {
+				size_t cnt = (*lo++)->stat.cnt;
+				if (op == UNION) a->stat.cnt += cnt;
+				else if (op == INTERSECTION) a->stat.cnt = std::min(a->stat.cnt, cnt);
+				else if (a->stat.cnt > cnt) a->stat.cnt -= cnt;
+				else a->stat.cnt = 0;
+				if (a->stat.cnt) out.Add(a);
+				else STBase::DestroyNode(*pool, a);
+			}
+			a = NULL;
+		}
+		return out.Root();
+	}
+
+	// Tree of height at most log n + 1 from nodes added in order. The
+	// i-th node goes at the height of the lowest set bit of i, on top of
+	// the pending nodes below that height; a node is updated once its
+	// right subtree is final
+	struct Builder {
+		std::vector<std::pair<Node *, size_t> > spine;
+		size_t n;
+
+		Builder() : n(0) {}
+
+		void Add(Node *x) {
+			size_t h = 0;
+			for (size_t i = ++n ; !(i & 1) ; i >>= 1) ++h;
+			x->Left() = Pop(h);
+			if (x->Left()) x->Left()->Parent() = x;
+			spine.push_back(std::make_pair(x, h));
+		}
+
+		Node *Root() {
+			Node *root = Pop(size_t(-1));
+			if (root) root->Parent() = NULL;
+			return root;
+		}
+
+	private:
+		// Pending nodes below height h, each the right child of the one before
+		Node *Pop(size_t h) {
+			Node *cur = NULL;
+			while (!spine.empty() && spine.back().second < h) {
+				Node *x = spine.back().first;
+				spine.pop_back();
+				x->Right() = cur;
+				if (cur) cur->Parent() = x;
+				STBase::Update(x);
+				cur = x;
+			}
+			return cur;
+		}
+	};
+
+	// Set operations of the tree under t with keys [lo, hi) of another
+	// tree. The count of the middle key is read first, it may be a node
+	// of this tree when other is this tree
+	Node *UnionRun(Node *t, Node *const *lo, Node *const *hi) {
+		if (lo == hi) return t;
+		Node *const *mid = lo + (hi - lo) / 2;
+		size_t cnt = (*mid)->stat.cnt;
+		Node *l, *e, *r;
+		Divide(t, (*mid)->key, l, e, r);
+		if (e) e->stat.cnt += cnt;
+		else e = STBase::CreateNode(*pool, (*mid)->key), e->stat.cnt = cnt;
+		l = UnionRun(l, lo, mid);
+		r = UnionRun(r, mid + 1, hi);
+		return Concat(l, e, r);
+	}
+
+	Node *IntersectionRun(Node *t, Node *const *lo, Node *const *hi) {
+		if (!t) return NULL;
+		if (lo == hi) return DestroyTree(t), (Node *)NULL;
+		Node *const *mid = lo + (hi - lo) / 2;
+		size_t cnt = (*mid)->stat.cnt;
+		Node *l, *e, *r;
+		Divide(t, (*mid)->key, l, e, r);
+		l = IntersectionRun(l, lo, mid);
+		r = IntersectionRun(r, mid + 1, hi);
+		if (!e) return Concat(l, r);
+		e->stat.cnt = std::min(e->stat.cnt, cnt);
+		return Concat(l, e, r);
+	}
+
+	Node *DifferenceRun(Node *t, Node *const *lo, Node *const *hi) {
+		if (!t || lo == hi) return t;
+		Node *const *mid = lo + (hi - lo) / 2;
+		size_t cnt = (*mid)->stat.cnt;
+		Node *l, *e, *r;
+		Divide(t, (*mid)->key, l, e, r);
+		l = DifferenceRun(l, lo, mid);
+		r = DifferenceRun(r, mid + 1, hi);
+		if (e && e->stat.cnt > cnt) {
+			e->stat.cnt -= cnt;
+			return Concat(l, e, r);
+		}
+		if (e) STBase::DestroyNode(*pool, e);
+		return Concat(l, r);
+	}
+
 	Node *root;
+	// Shared by the trees a Split made
+	std::shared_ptr<NodePool> pool;
 };
 
 #endif
@@ -0,0 +1,260 @@
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <set>
+#include <algorithm>
+#include <cstdlib>
+#include <chrono>
+
+#include "statistics.h"
+#include "splay_tree.h"
+#include "navigator.h"
+#include "bench_workload.h"
+
+using namespace std;
+
+typedef SplayTree<size_t, SubtreeSizeStatistic> ST;
+
+enum KeyPattern { SEQUENTIAL, UNIFORM, HOT };
+
+// Keys in order, uniformly random, or 90% of them from 1% of the range
+vector<size_t> make_keys(KeyPattern pattern, size_t n) {
+	vector<size_t> keys(n);
+	for (size_t i = 0; i < n; ++i) {
+		switch (pattern) {
+			case SEQUENTIAL: keys[i] = i; break;
+			case UNIFORM: keys[i] = rand() % n; break;
+			case HOT: keys[i] = rand() % 10?rand() % (n / 100 + 1):rand() % n; break;
+		}
+	}
+	return keys;
+}
+
+struct Timer {
+	typedef chrono::steady_clock Clock;
+	Latency &latency;
+	Clock::time_point t0;
+	Timer(Latency &latency) : latency(latency), t0(Clock::now()) {}
+	~Timer() { latency.Add(chrono::duration<double, nano>(Clock::now() - t0).count()); }
+};
+
+void report(const char *name, const char *op, Latency &latency) {
+	cout << "  " << left << setw(15) << name << setw(10) << op << right << setw(12)
+		<< size_t(latency.OpsPerSec()) << " ops/s" << setw(10) << size_t(latency.Percentile(0.5))
+		<< " ns p50" << setw(10) << size_t(latency.Percentile(0.99)) << " ns p99" << endl;
+}
+
+void bench(const char *pattern_name, KeyPattern pattern, size_t n) {
+	vector<size_t> insert = make_keys(pattern, n), find = make_keys(pattern, n), erase = make_keys(pattern, n);
+	cout << pattern_name << " keys, n = " << n << endl;
+
+	size_t check = 0, set_check = 0;
+	{
+		ST st;
+		Latency ins, fnd, rank, ers;
+		for (size_t i = 0; i < n; ++i) { Timer t(ins); st.Insert(insert[i]); }
+		for (size_t i = 0; i < n; ++i) { Timer t(fnd); check += st.Statistic(find[i]).cnt; }
+		for (size_t i = 0; i < n; ++i) { Timer t(rank); check += st.StatisticComp(find[i]).ss; }
+		for (size_t i = 0; i < n; ++i) { Timer t(ers); st.Erase(erase[i]); }
+		report("SplayTree", "Insert", ins), report("SplayTree", "Find", fnd);
+		report("SplayTree", "Rank", rank), report("SplayTree", "Erase", ers);
+	}
+	{
+		// Baseline without ranks
+		multiset<size_t> s;
+		Latency ins, fnd, ers;
+		for (size_t i = 0; i < n; ++i) { Timer t(ins); s.insert(insert[i]); }
+		for (size_t i = 0; i < n; ++i) { Timer t(fnd); set_check += s.find(find[i]) != s.end(); }
+		for (size_t i = 0; i < n; ++i) {
+			Timer t(ers);
+			multiset<size_t>::iterator it = s.find(erase[i]);
+			if (it != s.end()) s.erase(it);
+		}
+		report("std::multiset", "Insert", ins), report("std::multiset", "Find", fnd), report("std::multiset", "Erase", ers);
+	}
+	if (!check || !set_check) cout << "  (empty)" << endl;
+}
+
+double ms_since(Timer::Clock::time_point t0) {
+	return chrono::duration<double, milli>(Timer::Clock::now() - t0).count();
+}
+
+// Loading sorted keys, with the uniform finds that follow, and sorted
+// batches of growing size merged into a tree of n keys
+void bench_bulk(size_t n) {
+	typedef Timer::Clock Clock;
+	vector<size_t> sorted = make_keys(SEQUENTIAL, n), find = make_keys(UNIFORM, n);
+	cout << "bulk load of " << n << " sorted keys, then " << n << " uniform finds" << endl;
+	size_t check = 0;
+	for (int build = 0 ; build < 2 ; ++build) {
+		ST st;
+		Clock::time_point t0 = Clock::now();
+		if (build) st.BuildFromSorted(sorted.begin(), sorted.end());
+		else for (size_t i = 0 ; i < n ; ++i) st.Insert(sorted[i]);
+		double load = ms_since(t0);
+		t0 = Clock::now();
+		for (size_t i = 0 ; i < 1000 ; ++i) check += st.Statistic(find[i]).cnt;
+		double first = ms_since(t0);
+		for (size_t i = 1000 ; i < n ; ++i) check += st.Statistic(find[i]).cnt;
+		cout << "  " << left << setw(18) << (build?"BuildFromSorted":"Insert loop") << right
+			<< setw(10) << load << " ms load" << setw(10) << first << " ms first 1000 finds"
+			<< setw(10) << ms_since(t0) << " ms all finds" << endl;
+	}
+
+	// The batch arrives unsorted, InsertSorted pays for the sort
+	cout << "batch into a splay tree of " << n << " uniform keys" << endl;
+	vector<size_t> base = make_keys(UNIFORM, n);
+	for (size_t k = n / 1000 ; k <= n ; k *= 10) {
+		vector<size_t> batch = make_keys(UNIFORM, k);
+		double ms[3];
+		for (int way = 0 ; way < 3 ; ++way) {
+			ST st;
+			for (size_t i = 0 ; i < n ; ++i) st.Insert(base[i]);
+			vector<size_t> keys = batch;
+			Clock::time_point t0 = Clock::now();
+			if (way) sort(keys.begin(), keys.end());
+			if (way == 2) st.InsertSorted(keys.begin(), keys.end());
+			else for (size_t i = 0 ; i < k ; ++i) st.Insert(keys[i]);
+			ms[way] = ms_since(t0);
+			check += st.StatisticComp(n).ss;
+		}
+		cout << "  k = " << left << setw(10) << k << right << "Insert" << setw(10) << ms[0]
+			<< " ms   sort + Insert" << setw(10) << ms[1] << " ms   sort + InsertSorted" << setw(10) << ms[2] << " ms" << endl;
+	}
+	if (!check) cout << "  (empty)" << endl;
+}
+
+// Set operations of a tree of n uniform keys with one of k against one
+// Insert, lookup or Erase per key of the other tree, in sorted order
+void bench_set(size_t n) {
+	typedef Timer::Clock Clock;
+	cout << "set operations on a splay tree of " << n << " uniform keys" << endl;
+	vector<size_t> base = make_keys(UNIFORM, n);
+	size_t check = 0;
+	for (size_t k = n / 1000 ; k <= n ; k *= 10) {
+		vector<size_t> keys = make_keys(UNIFORM, k);
+		sort(keys.begin(), keys.end());
+		ST other;
+		other.BuildFromSorted(keys.begin(), keys.end());
+		double ms[6];
+		for (int way = 0 ; way < 6 ; ++way) {
+			ST st, result;
+			for (size_t i = 0 ; i < n ; ++i) st.Insert(base[i]);
+			Clock::time_point t0 = Clock::now();
+			switch (way) {
+				case 0: for (size_t i = 0 ; i < k ; ++i) st.Insert(keys[i]); break;
+				case 1: st.Union(other); break;
+				case 2:
+					for (size_t i = 0 ; i < k ; ++i)
+						if (st.Statistic(keys[i]).cnt > result.Statistic(keys[i]).cnt) result.Insert(keys[i]);
+					break;
+				case 3: st.Intersection(other); break;
+				case 4: for (size_t i = 0 ; i < k ; ++i) st.Erase(keys[i]); break;
+				case 5: st.Difference(other); break;
+			}
+			ms[way] = ms_since(t0);
+			check += st.StatisticComp(n).ss + result.StatisticComp(n).ss;
+		}
+		cout << "  k = " << left << setw(10) << k << right
+			<< "Insert" << setw(9) << ms[0] << " ms  Union" << setw(9) << ms[1]
+			<< " ms   lookup + Insert" << setw(9) << ms[2] << " ms  Intersection" << setw(9) << ms[3]
+			<< " ms   Erase" << setw(9) << ms[4] << " ms  Difference" << setw(9) << ms[5] << " ms" << endl;
+	}
+	if (!check) cout << "  (empty)" << endl;
+}
+
+// Full scans with the iterators and windows of 1% of the key range with
+// ForEachInRange, on the tree the inserts left, then a full scan by rank.
+// The scan by rank splays every key in order, which leaves a path
+void bench_scan(size_t n) {
+	typedef Timer::Clock Clock;
+	cout << "scans of a splay tree of " << n << " uniform keys" << endl;
+	vector<size_t> base = make_keys(UNIFORM, n);
+	ST st;
+	for (size_t i = 0 ; i < n ; ++i) st.Insert(base[i]);
+	size_t check = 0;
+	Clock::time_point t0 = Clock::now();
+	for (ST::const_iterator it = st.begin() ; it != st.end() ; ++it) check += *it * it.Stat().cnt;
+	double iter = ms_since(t0);
+	t0 = Clock::now();
+	for (size_t lo = 0 ; lo < n ; lo += n / 100)
+		st.ForEachInRange(lo, lo + n / 100, [&](size_t key, const SubtreeSizeStatistic &s) { check += key * s.cnt; });
+	double range = ms_since(t0);
+	t0 = Clock::now();
+	for (size_t i = 1 ; i <= n ; ++i) check += st.Find(RankNavigator(i));
+	double rank = ms_since(t0);
+	cout << "  iterators" << setw(10) << iter << " ms   100 x ForEachInRange" << setw(10) << range
+		<< " ms   Find(RankNavigator) per rank" << setw(10) << rank << " ms" << endl;
+	if (!check) cout << "  (empty)" << endl;
+}
+
+// Counts over random windows: CountInRange against two prefix counts
+void bench_range(size_t n) {
+	cout << "window counts on a splay tree of " << n << " uniform keys" << endl;
+	vector<size_t> base = make_keys(UNIFORM, n), lo = make_keys(UNIFORM, n), width = make_keys(UNIFORM, n);
+	ST st;
+	for (size_t i = 0 ; i < n ; ++i) st.Insert(base[i]);
+	size_t check = 0;
+	Latency prefix, range;
+	for (size_t i = 0 ; i < n ; ++i) {
+		Timer t(prefix);
+		size_t hi = lo[i] + width[i] % 1000;
+		check += st.StatisticComp(hi).ss - (lo[i]?st.StatisticComp(lo[i] - 1).ss:0);
+	}
+	for (size_t i = 0 ; i < n ; ++i) {
+		Timer t(range);
+		check -= st.CountInRange(lo[i], lo[i] + width[i] % 1000 + 1);
+	}
+	report("StatisticComp", "x 2", prefix), report("SplayTree", "Range", range);
+	if (check) cout << "  (mismatch)" << endl;
+}
+
+// Size, sum and min/max of windows: three trees against one tree of
+// CombinedStatistic, inserts included
+void bench_combined(size_t n) {
+	typedef Timer::Clock Clock;
+	typedef SumStatistic<size_t> Sum;
+	typedef MinMaxStatistic<size_t> MinMax;
+	typedef CombinedStatistic<SubtreeSizeStatistic, Sum, MinMax> Combined;
+	cout << "size, sum and min/max of windows over " << n << " uniform keys" << endl;
+	vector<size_t> base = make_keys(UNIFORM, n), lo = make_keys(UNIFORM, n);
+	size_t check = 0;
+	Clock::time_point t0 = Clock::now();
+	{
+		SplayTree<size_t, SubtreeSizeStatistic> sizes;
+		SplayTree<size_t, Sum> sums;
+		SplayTree<size_t, MinMax> minmax;
+		for (size_t i = 0 ; i < n ; ++i) sizes.Insert(base[i]), sums.Insert(base[i]), minmax.Insert(base[i]);
+		for (size_t i = 0 ; i < n ; ++i) {
+			check += sizes.RangeStatistic(lo[i], lo[i] + 1000).ss + sums.RangeStatistic(lo[i], lo[i] + 1000).sum;
+			check += minmax.RangeStatistic(lo[i], lo[i] + 1000).max_weight;
+		}
+	}
+	double three = ms_since(t0);
+	t0 = Clock::now();
+	{
+		SplayTree<size_t, Combined> st;
+		for (size_t i = 0 ; i < n ; ++i) st.Insert(base[i]);
+		for (size_t i = 0 ; i < n ; ++i) {
+			Combined s = st.RangeStatistic(lo[i], lo[i] + 1000);
+			check -= s.ss + s.Get<Sum>().sum + s.Get<MinMax>().max_weight;
+		}
+	}
+	cout << "  three trees" << setw(10) << three << " ms   CombinedStatistic" << setw(10) << ms_since(t0) << " ms" << endl;
+	if (check) cout << "  (mismatch)" << endl;
+}
+
+int main(int argc, const char *argv[])
+{
+	size_t n = argc > 1?atol(argv[1]):1000000;
+	srand(1);
+	bench("sequential", SEQUENTIAL, n);
+	bench("uniform", UNIFORM, n);
+	bench("hot", HOT, n);
+	bench_bulk(n);
+	bench_set(n);
+	bench_scan(n);
+	bench_range(n);
+	bench_combined(n);
+	return 0;
+}
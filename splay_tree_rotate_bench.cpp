@@ -0,0 +1,89 @@
+#include <iostream>
+#include <vector>
+#include <cstdlib>
+#include <chrono>
+
+#include "statistics.h"
+#include "splay_tree.h"
+
+using namespace std;
+
+// Splaying as it was done before: every rotation recomputes the old
+// parent, the rotated node and its new parent
+template <class Node>
+struct ThreeUpdateSplay {
+	typedef SplayTreeBase<size_t, Node, std::less<size_t> > ST;
+
+	static void Rotate(Node *x) {
+		Node *y = x->Parent();
+		x->Parent() = y->Parent();
+		if (!ST::IsRoot(y)) (y->Parent()->Left()==y)?(y->Parent()->Left()=x):(y->Parent()->Right()=x);
+		y->Parent() = x;
+		if (y->Left() == x) {
+			if (x->Right()) x->Right()->Parent() = y;
+			y->Left() = x->Right(), x->Right() = y;
+		} else {
+			if (x->Left()) x->Left()->Parent() = y;
+			y->Right() = x->Left(), x->Left() = y;
+		}
+		y->Update(), x->Update();
+		if (!ST::IsRoot(x)) x->Parent()->Update();
+	}
+
+	static size_t SplayNode(Node *x) {
+		size_t rotations = 0;
+		while (!ST::IsRoot(x)) {
+			Node *y = x->Parent();
+			if (ST::IsRoot(y)) Rotate(x), rotations += 1;
+			else if ((y->Parent()->Left() == y && x == y->Left())
+					||(y->Parent()->Right() == y && x == y->Right()))
+				Rotate(y), Rotate(x), rotations += 2;
+			else Rotate(x), Rotate(x), rotations += 2;
+		}
+		return rotations;
+	}
+};
+
+template <class Stat>
+void bench(const char *name, size_t N, size_t splays) {
+	typedef SplayNode<size_t, Stat> Node;
+	typedef SplayTreeBase<size_t, Node, std::less<size_t> > ST;
+	NodePool<Node> pool;
+	vector<Node *> before, after;
+	for (size_t i = 0; i < N; ++i) {
+		before.push_back(ST::CreateNode(pool, i));
+		after.push_back(ST::CreateNode(pool, i));
+	}
+	ST::BuildBalanced(before.data(), before.data() + N);
+	ST::BuildBalanced(after.data(), after.data() + N);
+	// Same splay sequences on identical trees, so both do the same rotations.
+	// Rounds alternate between the two and the best round is kept
+	double old_rate = 0, new_rate = 0;
+	vector<size_t> order(splays);
+	for (size_t round = 0; round < 5; ++round) {
+		for (size_t i = 0; i < splays; ++i) order[i] = rand() % N;
+		size_t rotations = 0;
+		chrono::steady_clock::time_point t0 = chrono::steady_clock::now();
+		for (size_t i = 0; i < splays; ++i) rotations += ThreeUpdateSplay<Node>::SplayNode(before[order[i]]);
+		chrono::steady_clock::time_point t1 = chrono::steady_clock::now();
+		for (size_t i = 0; i < splays; ++i) ST::SplayNode(after[order[i]]);
+		chrono::steady_clock::time_point t2 = chrono::steady_clock::now();
+		old_rate = max(old_rate, rotations / chrono::duration<double>(t1 - t0).count());
+		new_rate = max(new_rate, rotations / chrono::duration<double>(t2 - t1).count());
+	}
+
+	cout << name << ": three updates " << size_t(old_rate)
+		<< " rotations/s, single update " << size_t(new_rate)
+		<< " rotations/s, speedup " << new_rate / old_rate << endl;
+}
+
+int main(int argc, const char *argv[])
+{
+	size_t N = argc > 1?atol(argv[1]):100000;
+	srand(1);
+	bench<Statistic>("Statistic", N, N);
+	bench<SubtreeSizeStatistic>("SubtreeSizeStatistic", N, N);
+	bench<SumStatistic<size_t> >("SumStatistic", N, N);
+	bench<MinMaxStatistic<size_t> >("MinMaxStatistic", N, N);
+	return 0;
+}
@@ -1,6 +1,7 @@
 #include <iostream>
 #include <vector>
 #include <cstdlib>
+#include <algorithm>
 #include "statistics.h"
 #include "splay_tree.h"
 #include "navigator.h"
@@ -37,8 +38,280 @@ void splay_tree_test(size_t N) {
 	std::cout << "I'm Done" << std::endl;
 }
 
+// Rank of every key and its duplicate count against a plain count array
+void check_counts(SplayTree<int, SubtreeSizeStatistic> &st, const vector<size_t> &count) {
+	size_t below = 0;
+	for (size_t x = 0 ; x < count.size() ; ++x) {
+		below += count[x];
+		assert(st.Statistic(x).cnt == count[x]);
+		assert(st.StatisticComp(x).ss == below);
+	}
+}
+
+void splay_tree_bulk_test(size_t N) {
+	vector<size_t> count(N, 0);
+	vector<int> keys;
+	for (size_t i = 0 ; i < N ; i++) keys.push_back(rand() % N), ++count[keys.back()];
+	sort(keys.begin(), keys.end());
+	SplayTree<int, SubtreeSizeStatistic> st;
+	st.BuildFromSorted(keys.begin(), keys.end());
+	check_counts(st, count);
+
+	// Batches small and large next to the tree, with keys already in it
+	size_t sizes[] = { 1, 10, N / 100, N / 2, 3 * N };
+	for (size_t b = 0 ; b < 5 ; ++b) {
+		vector<int> batch;
+		for (size_t i = 0 ; i < sizes[b] ; i++) batch.push_back(rand() % N), ++count[batch.back()];
+		sort(batch.begin(), batch.end());
+		st.InsertSorted(batch.begin(), batch.end());
+		check_counts(st, count);
+	}
+	for (size_t x = 0 ; x < N ; ++x)
+		for (; count[x] ; --count[x]) st.Erase(x);
+	check_counts(st, count);
+
+	// Into an empty tree
+	SplayTree<int, SubtreeSizeStatistic> empty;
+	empty.BuildFromSorted(keys.end(), keys.end());
+	empty.InsertSorted(keys.begin(), keys.end());
+	for (size_t i = 0 ; i < N ; ++i) count[keys[i]]++;
+	check_counts(empty, count);
+	std::cout << "Bulk Done" << std::endl;
+}
+
+typedef SplayTree<int, SubtreeSizeStatistic> IntTree;
+
+// Random keys in [0, n) into the tree and the count array
+void fill(IntTree &st, vector<size_t> &count, size_t m, size_t n) {
+	for (size_t i = 0 ; i < m ; i++) {
+		size_t x = rand() % n;
+		st.Insert(x), ++count[x];
+	}
+}
+
+void splay_tree_split_join_test(size_t N) {
+	vector<size_t> count(N, 0), none(N, 0);
+	IntTree *st = new IntTree;
+	fill(*st, count, N, N);
+
+	// Split in three, then drop the first tree before the others
+	IntTree mid, right;
+	st->Split(N / 3, mid);
+	mid.Split(2 * N / 3, right);
+	vector<size_t> lc(count), mc(count), rc(count);
+	for (size_t x = 0 ; x < N ; ++x) (x < N / 3?mc[x]:lc[x]) = 0, (x < 2 * N / 3?rc[x]:mc[x]) = 0;
+	check_counts(*st, lc);
+	check_counts(mid, mc);
+	check_counts(right, rc);
+	mid.Insert(N / 2), mid.Erase(N / 2), right.Insert(N - 1), ++rc[N - 1];
+	delete st;
+	check_counts(right, rc);
+	mid.Join(right);
+	for (size_t x = 0 ; x < N ; ++x) mc[x] += rc[x];
+	check_counts(mid, mc);
+	check_counts(right, none);
+
+	// Join of separate trees, the pool of the right one is adopted
+	IntTree low, high;
+	vector<size_t> hc(N, 0);
+	for (size_t x = 0 ; x < N / 3 ; ++x) low.Insert(x);
+	low.Join(mid);
+	for (size_t x = 0 ; x < N / 3 ; ++x) mc[x] = 1;
+	check_counts(low, mc);
+	check_counts(mid, none);
+	mid.Insert(0), mid.Erase(0);
+
+	// Join of a tree still sharing its pool copies its nodes
+	low.Split(N / 2, high);
+	IntTree other;
+	for (size_t x = 0 ; x < N / 4 ; ++x) other.Insert(x);
+	high.Split(3 * N / 4, right);
+	other.Split(N / 5, mid);
+	mid.Join(high);
+	for (size_t x = 0 ; x < N ; ++x) hc[x] = (x >= N / 5 && x < N / 4) + (x >= N / 2 && x < 3 * N / 4?mc[x]:0);
+	check_counts(mid, hc);
+	check_counts(high, none);
+
+	// Range deletes
+	low.Join(right);
+	for (size_t x = N / 2 ; x < N ; ++x) mc[x] = x < 3 * N / 4?0:mc[x];
+	check_counts(low, mc);
+	low.EraseRange(N / 10, N / 5);
+	low.EraseRange(N / 5, N / 5);
+	low.EraseRange(N - 10, 2 * N);
+	for (size_t x = 0 ; x < N ; ++x) if ((x >= N / 10 && x < N / 5) || x >= N - 10) mc[x] = 0;
+	check_counts(low, mc);
+	low.Clear();
+	check_counts(low, none);
+	std::cout << "Split Join Done" << std::endl;
+}
+
+void splay_tree_set_test(size_t N) {
+	size_t sizes[] = { 0, 1, 10, N / 10, N, 4 * N };
+	for (size_t a = 0 ; a < 6 ; ++a) for (size_t b = 0 ; b < 6 ; ++b) {
+		vector<size_t> ac(N, 0), bc(N, 0), expect(N);
+		IntTree x, y;
+		fill(x, ac, sizes[a], N);
+		fill(y, bc, sizes[b], N);
+		switch ((a + b) % 3) {
+			case 0:
+				x.Union(y);
+				for (size_t k = 0 ; k < N ; ++k) expect[k] = ac[k] + bc[k];
+				break;
+			case 1:
+				x.Intersection(y);
+				for (size_t k = 0 ; k < N ; ++k) expect[k] = min(ac[k], bc[k]);
+				break;
+			case 2:
+				x.Difference(y);
+				for (size_t k = 0 ; k < N ; ++k) expect[k] = ac[k] > bc[k]?ac[k] - bc[k]:0;
+				break;
+		}
+		check_counts(x, expect);
+		check_counts(y, bc);
+	}
+
+	// With itself
+	vector<size_t> count(N, 0);
+	IntTree x;
+	fill(x, count, N, N);
+	x.Union(x);
+	for (size_t k = 0 ; k < N ; ++k) count[k] *= 2;
+	check_counts(x, count);
+	x.Intersection(x);
+	check_counts(x, count);
+	x.Difference(x);
+	check_counts(x, vector<size_t>(N, 0));
+	std::cout << "Set Done" << std::endl;
+}
+
+// Sum of the counts of keys in [lo, hi) through ForEachInRange
+size_t count_in_range(const IntTree &st, int lo, int hi) {
+	size_t total = 0;
+	int last = lo - 1;
+	st.ForEachInRange(lo, hi, [&](int key, const SubtreeSizeStatistic &s) {
+		assert(key > last && key >= lo && key < hi);
+		last = key, total += s.cnt;
+	});
+	return total;
+}
+
+void splay_tree_iterator_test(size_t N) {
+	vector<size_t> count(N, 0);
+	IntTree st;
+	const IntTree &cst = st;
+	assert(cst.begin() == cst.end() && count_in_range(cst, 0, N) == 0);
+	fill(st, count, N, N);
+
+	// Forward, backward and reverse scans of a const tree
+	vector<int> keys;
+	for (IntTree::const_iterator it = cst.begin() ; it != cst.end() ; ++it) {
+		assert(it.Stat().cnt == count[*it]);
+		keys.push_back(*it);
+	}
+	size_t i = keys.size();
+	for (IntTree::const_iterator it = cst.end() ; it != cst.begin() ;) assert(*--it == keys[--i]);
+	assert(i == 0 && equal(keys.rbegin(), keys.rend(), cst.rbegin()));
+	for (size_t x = 0, j = 0 ; x < N ; ++x) if (count[x]) assert(keys[j++] == int(x));
+
+	// Iterators survive splaying and the erase of other keys
+	IntTree::const_iterator first = cst.begin(), mid = first;
+	for (size_t k = 0 ; k < keys.size() / 2 ; ++k) ++mid;
+	for (size_t k = 0 ; k < N ; ++k) {
+		size_t x = rand() % N;
+		if (int(x) == *first || int(x) == *mid) continue;
+		if (rand() % 2) st.Insert(x), ++count[x];
+		else if (count[x]) st.Erase(x), --count[x];
+	}
+	assert(*first == keys[0] && *mid == keys[keys.size() / 2]);
+	size_t seen = 0;
+	for (IntTree::const_iterator it = mid ; it != cst.end() ; it++) seen += it.Stat().cnt;
+	for (IntTree::const_iterator it = mid ; it != first ;) seen += (--it).Stat().cnt;
+	size_t expect = 0;
+	for (size_t x = keys[0] ; x < N ; ++x) expect += count[x];
+	assert(seen == expect);
+
+	// Range scans against prefix counts
+	for (size_t k = 0 ; k < 100 ; ++k) {
+		int lo = rand() % (N + 10) - 5, hi = lo + rand() % (N / 4);
+		size_t expect = 0;
+		for (int x = max(lo, 0) ; x < hi && x < int(N) ; ++x) expect += count[x];
+		assert(count_in_range(cst, lo, hi) == expect);
+	}
+	std::cout << "Iterator Done" << std::endl;
+}
+
+void splay_tree_range_test(size_t N) {
+	vector<size_t> count(N, 0), prefix(N + 1, 0);
+	IntTree st;
+	assert(st.Rank(0) == 0 && st.CountInRange(0, 1) == 0 && st.LowerBound(0) == st.end());
+	fill(st, count, N, N);
+	for (size_t x = 0 ; x < N ; ++x) prefix[x + 1] = prefix[x] + count[x];
+	for (size_t k = 0 ; k < N ; ++k) {
+		int lo = rand() % (N + 10) - 5, hi = lo + rand() % (N / 2) - N / 8;
+		int l = min(max(lo, 0), int(N)), h = min(max(hi, l), int(N));
+		assert(st.CountInRange(lo, hi) == prefix[h] - prefix[l]);
+		assert(st.Rank(lo) == prefix[l]);
+
+		IntTree::const_iterator it = st.LowerBound(lo), up = st.UpperBound(lo);
+		while (l < int(N) && !count[l]) ++l;
+		assert(l == int(N)?it == st.end():*it == l);
+		int u = min(max(lo + 1, 0), int(N));
+		while (u < int(N) && !count[u]) ++u;
+		assert(u == int(N)?up == st.end():*up == u);
+	}
+
+	// Windowed sums of distinct keys
+	SplayTree<long, SumStatistic<long> > sums;
+	for (size_t x = 0 ; x < N ; x += 3) sums.Insert(x);
+	for (size_t k = 0 ; k < N ; ++k) {
+		long lo = rand() % N, hi = lo + rand() % N, expect = 0;
+		for (long x = lo ; x < hi && x < long(N) ; ++x) expect += x % 3?0:x;
+		assert(sums.RangeStatistic(lo, hi).sum == expect);
+	}
+	std::cout << "Range Done" << std::endl;
+}
+
+struct SizeLess {
+	bool operator()(const SubtreeSizeStatistic &a, const SubtreeSizeStatistic &b) const { return a.ss < b.ss; }
+};
+
+void splay_tree_navigator_test(size_t N) {
+	// Weighted rank over distinct keys, weight = key
+	SplayTree<long, SumStatistic<long> > st;
+	vector<long> keys, prefix(1, 0);
+	for (long x = 1 ; keys.size() < N ; x += 1 + rand() % 3) st.Insert(x), keys.push_back(x), prefix.push_back(prefix.back() + x);
+	for (size_t k = 0 ; k < N ; ++k) {
+		long t = rand() % (prefix.back() + 10);
+		size_t lo = lower_bound(prefix.begin() + 1, prefix.end(), t) - prefix.begin() - 1;
+		size_t up = upper_bound(prefix.begin() + 1, prefix.end(), t) - prefix.begin() - 1;
+		assert(st.Find(PrefixSumNavigator<long>(t), -1) == (lo < N?keys[lo]:-1));
+		assert(st.Find(PrefixSumNavigator<long, SumStatistic<long>, true>(t), -1) == (up < N?keys[up]:-1));
+	}
+
+	// Bounds by count with duplicates, against RankNavigator
+	IntTree counts;
+	vector<size_t> count(N, 0);
+	fill(counts, count, 3 * N, N);
+	for (size_t r = 1 ; r <= 3 * N ; ++r) {
+		SubtreeSizeStatistic bound;
+		bound.ss = r - 1;
+		int key = counts.Find(RankNavigator(r));
+		assert(counts.Find(StatBoundNavigator<SubtreeSizeStatistic, SizeLess, true>(bound)) == key);
+		bound.ss = r;
+		assert(counts.Find(StatBoundNavigator<SubtreeSizeStatistic, SizeLess>(bound)) == key);
+	}
+	std::cout << "Navigator Done" << std::endl;
+}
+
 int main(int argc, const char *argv[])
 {
 	splay_tree_test(10000);
+	splay_tree_bulk_test(10000);
+	splay_tree_split_join_test(3000);
+	splay_tree_set_test(1000);
+	splay_tree_iterator_test(5000);
+	splay_tree_range_test(5000);
+	splay_tree_navigator_test(3000);
 	return 0;
 }
@@ -1,11 +1,13 @@
 #ifndef __STATISTICS_H__
 #define __STATISTICS_H__
 
+#include <cstddef>
 #include <limits>
 
 // TODO: Write down the limit of statistic functions
 // Also if the statistic is for evertable link cut tree then,
-// UpdateLeft and UpdateRight should behave same.
+// UpdateLeft and UpdateRight should behave same, unless it is an
+// ordered statistic (IsOrderedStatistic).
 
 // Basic Statistic 
 // Computing subtree size and keeping the same key in the same node
@@ -35,82 +37,292 @@ class Statistic {
 
 	template <typename ST>
 	void UpdateRight(const ST& s) {}
+
+	template <typename ST>
+	void Subtract(const ST& s) {}
+
+	// Path updates of n keys at once (link cut tree)
+	template <typename T>
+	void ApplyAdd(const T& delta, size_t n) {}
+
+	template <typename T>
+	void ApplyAssign(const T& value, size_t n) {}
+};
+
+// Statistic without the duplicate key counter
+// Trees that never hold the same key twice (link cut tree, euler tree)
+// can build statistics on top of this to save the counter per node
+class EmptyStatistic {
+	public:
+	bool Exist() {
+		return true;
+	}
+
+	void Add() {}
+
+	void Remove() {}
+
+	template <typename T>
+	void Init(const T& key) {}
+
+	template <typename ST>
+	void UpdateLeft(const ST& s) {}
+
+	template <typename ST>
+	void UpdateRight(const ST& s) {}
+
+	template <typename ST>
+	void Subtract(const ST& s) {}
+
+	// Path updates of n keys at once (link cut tree)
+	template <typename T>
+	void ApplyAdd(const T& delta, size_t n) {}
+
+	template <typename T>
+	void ApplyAssign(const T& value, size_t n) {}
 };
 
-class SubtreeSizeStatistic: public Statistic {
+// Statistics that aggregate nothing, trees skip recomputing them
+template <class Stat>
+struct IsTrivialStatistic { enum { value = false }; };
+
+template <>
+struct IsTrivialStatistic<Statistic> { enum { value = true }; };
+
+template <>
+struct IsTrivialStatistic<EmptyStatistic> { enum { value = true }; };
+
+// Statistics read in path order, UpdateLeft(l) puts l before what is
+// there and UpdateRight(r) after it, and the two need not commute
+// (composition of maps, hashes of the key sequence). An evertable link
+// cut tree keeps them in both directions so that Evert stays lazy.
+// Specialize to opt in
+template <class Stat>
+struct IsOrderedStatistic { enum { value = false }; };
+
+// Statistics holding addresses into the tree (MinMaxStatistic with Arg).
+// Snapshot files refuse them, the addresses would not survive the process
+template <class Stat>
+struct IsAddressStatistic { enum { value = false }; };
+
+// Keys in the subtree, duplicates included.
+// Base has to keep the counter (Statistic)
+template <class Base = Statistic>
+class SizeStatistic : public Base {
 	public:
 	size_t ss;
-	SubtreeSizeStatistic()
-		: Statistic(),
-		ss(0) {}
+	SizeStatistic() : Base(), ss(0) {}
+
 	template <typename T>
 	void Init(const T& key) {
-		ss = cnt;
+		ss = this->cnt;
+		Base::Init(key);
 	}
 
-	void UpdateLeft(const SubtreeSizeStatistic& s) {
+	void UpdateLeft(const SizeStatistic& s) {
 		Update(s);
+		Base::UpdateLeft(s);
 	}
 
-	void UpdateRight(const SubtreeSizeStatistic& s) {
+	void UpdateRight(const SizeStatistic& s) {
 		Update(s);
+		Base::UpdateRight(s);
 	}
 
-	void Update(const SubtreeSizeStatistic& s) {
+	void Update(const SizeStatistic& s) {
 		ss += s.ss;
 	}
+
+	// Take out what Update added (subtree aggregates of link cut tree)
+	void Subtract(const SizeStatistic& s) {
+		ss -= s.ss;
+		Base::Subtract(s);
+	}
+};
+
+typedef SizeStatistic<> SubtreeSizeStatistic;
+
+// Where the minimum and maximum of a MinMaxStatistic are, kept when Arg
+// is set: the keys holding them, by address, so they point into the nodes
+// of the tree (and are not kept by snapshots). Of equal keys, either one
+template <typename T, bool Arg>
+class MinMaxArg {
+	public:
+	const T *min_key, *max_key;
+	MinMaxArg() : min_key(NULL), max_key(NULL) {}
+	void InitArg(const T& key) { min_key = max_key = &key; }
+	void TakeMin(const MinMaxArg& s) { min_key = s.min_key; }
+	void TakeMax(const MinMaxArg& s) { max_key = s.max_key; }
 };
 
 template <typename T>
-class MinMaxStatistic : public Statistic {
+class MinMaxArg<T, false> {
+	public:
+	void InitArg(const T& key) {}
+	void TakeMin(const MinMaxArg& s) {}
+	void TakeMax(const MinMaxArg& s) {}
+};
+
+template <typename T, class Base = Statistic, bool Arg = false>
+class MinMaxStatistic : public Base, public MinMaxArg<T, Arg> {
 	public:
 	T min_weight;
 	T max_weight;
 	MinMaxStatistic() 
-		: Statistic(), 
+		: Base(), 
 		min_weight(std::numeric_limits<T>::max()),
 		max_weight(std::numeric_limits<T>::min()) {}
 
 	void Init(const T& key) {
 		min_weight = key;
 		max_weight = key;
+		this->InitArg(key);
+		Base::Init(key);
 	}
 
 	void UpdateLeft(const MinMaxStatistic& s) {
 		Update(s);
+		Base::UpdateLeft(s);
 	}
 
 	void UpdateRight(const MinMaxStatistic& s) {
 		Update(s);
+		Base::UpdateRight(s);
 	}
 
 	void Update(const MinMaxStatistic& s) {
-		min_weight = std::min(min_weight, s.min_weight);
-		max_weight = std::max(max_weight, s.max_weight);
+		if (s.min_weight < min_weight) min_weight = s.min_weight, this->TakeMin(s);
+		if (max_weight < s.max_weight) max_weight = s.max_weight, this->TakeMax(s);
+	}
+
+	void ApplyAdd(const T& delta, size_t n) {
+		min_weight += delta;
+		max_weight += delta;
+		Base::ApplyAdd(delta, n);
+	}
+
+	void ApplyAssign(const T& value, size_t n) {
+		min_weight = max_weight = value;
+		Base::ApplyAssign(value, n);
 	}
 };
 
-template <typename T>
-class SumStatistic : public Statistic {
+template <typename T, class Base = Statistic>
+class SumStatistic : public Base {
 	public:
 	T sum;
-	SumStatistic() : Statistic() {}
+	SumStatistic() : Base(), sum() {}
 	void Init(const T& key) {
 		sum = key;
-		Statistic::Init(key);
+		Base::Init(key);
 	}
 
 	void UpdateLeft(const SumStatistic& s) {
 		Update(s);
+		Base::UpdateLeft(s);
 	}
 
 	void UpdateRight(const SumStatistic& s) {
 		Update(s);
+		Base::UpdateRight(s);
 	}
 
 	void Update(const SumStatistic& s) {
 		sum += s.sum;
 	}
+
+	void Subtract(const SumStatistic& s) {
+		sum -= s.sum;
+		Base::Subtract(s);
+	}
+
+	void ApplyAdd(const T& delta, size_t n) {
+		sum += delta * T(n);
+		Base::ApplyAdd(delta, n);
+	}
+
+	void ApplyAssign(const T& value, size_t n) {
+		sum = value * T(n);
+		Base::ApplyAssign(value, n);
+	}
+};
+
+// Statistic S moved on top of Base in place of its own base chain.
+// Specialize it to combine statistics defined elsewhere
+template <class S, class Base>
+struct RebaseStatistic;
+
+template <class Base>
+struct RebaseStatistic<Statistic, Base> { typedef Base type; };
+
+template <class Base>
+struct RebaseStatistic<EmptyStatistic, Base> { typedef Base type; };
+
+template <class B, class Base>
+struct RebaseStatistic<SizeStatistic<B>, Base> {
+	typedef SizeStatistic<typename RebaseStatistic<B, Base>::type> type;
+};
+
+template <typename T, class B, bool Arg, class Base>
+struct RebaseStatistic<MinMaxStatistic<T, B, Arg>, Base> {
+	typedef MinMaxStatistic<T, typename RebaseStatistic<B, Base>::type, Arg> type;
+};
+
+template <typename T, class B, class Base>
+struct RebaseStatistic<SumStatistic<T, B>, Base> {
+	typedef SumStatistic<T, typename RebaseStatistic<B, Base>::type> type;
+};
+
+// S... stacked on one Statistic, the first on top
+template <class... S>
+struct StatisticChain { typedef Statistic type; };
+
+template <class S, class... Rest>
+struct StatisticChain<S, Rest...> {
+	typedef typename RebaseStatistic<S, typename StatisticChain<Rest...>::type>::type type;
+};
+
+// Layer of the chain that C became
+template <class C, class... S>
+struct StatisticLayer;
+
+template <class C, class... Rest>
+struct StatisticLayer<C, C, Rest...> { typedef typename StatisticChain<C, Rest...>::type type; };
+
+template <class C, class S, class... Rest>
+struct StatisticLayer<C, S, Rest...> { typedef typename StatisticLayer<C, Rest...>::type type; };
+
+// Several statistics on the same keys in one node, e.g.
+// CombinedStatistic<SubtreeSizeStatistic, SumStatistic<long>, MinMaxStatistic<long> >.
+// The components are stacked as bases of each other over a single cnt,
+// and each Init/UpdateLeft/UpdateRight/Subtract runs down the whole stack
+// in one call. Get<S>() is the part computed as S.
+template <class... S>
+class CombinedStatistic : public StatisticChain<S...>::type {
+	public:
+	template <class C>
+	const typename StatisticLayer<C, S...>::type &Get() const {
+		return *this;
+	}
+
+	template <class C>
+	typename StatisticLayer<C, S...>::type &Get() {
+		return *this;
+	}
+};
+
+template <class B>
+struct IsAddressStatistic<SizeStatistic<B> > { enum { value = IsAddressStatistic<B>::value }; };
+
+template <typename T, class B, bool Arg>
+struct IsAddressStatistic<MinMaxStatistic<T, B, Arg> > { enum { value = Arg || IsAddressStatistic<B>::value }; };
+
+template <typename T, class B>
+struct IsAddressStatistic<SumStatistic<T, B> > { enum { value = IsAddressStatistic<B>::value }; };
+
+template <class... S>
+struct IsAddressStatistic<CombinedStatistic<S...> > {
+	enum { value = IsAddressStatistic<typename StatisticChain<S...>::type>::value };
 };
 
 #endif
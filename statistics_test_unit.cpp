@@ -0,0 +1,115 @@
+#include <iostream>
+#include <vector>
+#include <cstdlib>
+#include <cassert>
+#include <algorithm>
+#include <numeric>
+
+#include "statistics.h"
+#include "splay_tree.h"
+#include "link_cut_tree.h"
+
+using namespace std;
+
+typedef SumStatistic<long> Sum;
+typedef MinMaxStatistic<long> MinMax;
+typedef CombinedStatistic<SubtreeSizeStatistic, Sum, MinMax> Combined;
+
+// One tree with every component against a brute force over the keys
+void combined_splay_tree_test(size_t N) {
+	static_assert(sizeof(Combined) == sizeof(size_t) + sizeof(size_t) + 3 * sizeof(long), "one counter");
+	SplayTree<long, Combined> st;
+	vector<size_t> count(N, 0);
+	for (size_t i = 0 ; i < 2 * N ; ++i) {
+		long x = rand() % N;
+		if (rand() % 4) st.Insert(x), ++count[x];
+		else if (count[x]) st.Erase(x), --count[x];
+	}
+	for (size_t k = 0 ; k < N ; ++k) {
+		long lo = rand() % N, hi = lo + rand() % (N / 4) + 1;
+		size_t size = 0;
+		long sum = 0, mn = numeric_limits<long>::max(), mx = numeric_limits<long>::min();
+		for (long x = lo ; x < hi && x < long(N) ; ++x) {
+			if (!count[x]) continue;
+			size += count[x], sum += x, mn = min(mn, x), mx = max(mx, x);
+		}
+		Combined s = st.RangeStatistic(lo, hi);
+		assert(s.Get<SubtreeSizeStatistic>().ss == size && s.ss == size);
+		assert(s.Get<Sum>().sum == sum);
+		assert(s.Get<MinMax>().min_weight == mn && s.Get<MinMax>().max_weight == mx);
+		assert(st.CountInRange(lo, hi) == size);
+	}
+	std::cout << "Combined splay tree test Done" << std::endl;
+}
+
+// Path aggregates and path updates through every component
+void combined_link_cut_tree_test(size_t N) {
+	typedef LinkCutTree<long, CombinedStatistic<Sum, MinMax>, true> LCT;
+	LCT lct;
+	vector<LCT::Node *> nodes;
+	vector<long> key(N);
+	for (size_t i = 0 ; i < N ; ++i) key[i] = rand() % 1000, nodes.push_back(lct.Add(key[i]));
+	for (size_t i = 1 ; i < N ; ++i) lct.Link(nodes[i], nodes[i - 1]);
+	lct.Evert(nodes[N / 2]);
+	lct.PathAdd(nodes[N - 1], 5);
+	for (size_t i = N / 2 ; i < N ; ++i) key[i] += 5;
+	for (size_t k = 0 ; k < N ; ++k) {
+		size_t v = rand() % N, lo = min(v, N / 2), hi = max(v, N / 2) + 1;
+		CombinedStatistic<Sum, MinMax> s = lct.Path(nodes[v]);
+		assert(s.Get<Sum>().sum == accumulate(key.begin() + lo, key.begin() + hi, 0L));
+		assert(s.Get<MinMax>().min_weight == *min_element(key.begin() + lo, key.begin() + hi));
+		assert(s.Get<MinMax>().max_weight == *max_element(key.begin() + lo, key.begin() + hi));
+	}
+	std::cout << "Combined link cut tree test Done" << std::endl;
+}
+
+// Layered statistics keep the layers below up to date
+void chained_statistic_test(size_t N) {
+	SplayTree<long, SumStatistic<long, SubtreeSizeStatistic> > st;
+	long sum = 0;
+	for (size_t i = 0 ; i < N ; ++i) st.Insert(i), sum += i;
+	st.Insert(0);
+	assert(st.StatisticComp(N).ss == N + 1 && st.StatisticComp(N).sum == sum);
+	std::cout << "Chained statistic test Done" << std::endl;
+}
+
+// Where the extremes of a path are, after path adds
+void arg_min_max_test(size_t N) {
+	static_assert(sizeof(MinMax) == sizeof(size_t) + 2 * sizeof(long), "no arguments kept");
+	typedef MinMaxStatistic<long, Statistic, true> ArgMinMax;
+	typedef LinkCutTree<long, ArgMinMax, true> LCT;
+	LCT lct;
+	vector<LCT::Node *> nodes;
+	vector<long> key(N);
+	for (size_t i = 0 ; i < N ; ++i) key[i] = rand() % 100, nodes.push_back(lct.Add(key[i]));
+	for (size_t i = 1 ; i < N ; ++i) lct.Link(nodes[i], nodes[i - 1]);
+	for (size_t k = 0 ; k < N ; ++k) {
+		size_t u = rand() % N, v = rand() % N, lo = min(u, v), hi = max(u, v) + 1;
+		lct.Evert(nodes[u]);
+		if (k % 2) {
+			long delta = rand() % 10;
+			lct.PathAdd(nodes[v], delta);
+			for (size_t i = lo ; i < hi ; ++i) key[i] += delta;
+		}
+		ArgMinMax s = lct.Path(nodes[v]);
+		assert(s.min_weight == *min_element(key.begin() + lo, key.begin() + hi));
+		assert(s.max_weight == *max_element(key.begin() + lo, key.begin() + hi));
+		size_t amin = N, amax = N;
+		for (size_t i = lo ; i < hi ; ++i) {
+			if (s.min_key == &nodes[i]->key) amin = i;
+			if (s.max_key == &nodes[i]->key) amax = i;
+		}
+		assert(amin < N && key[amin] == s.min_weight);
+		assert(amax < N && key[amax] == s.max_weight);
+	}
+	std::cout << "Arg min max test Done" << std::endl;
+}
+
+int main(int argc, const char *argv[])
+{
+	combined_splay_tree_test(3000);
+	combined_link_cut_tree_test(2000);
+	chained_statistic_test(1000);
+	arg_min_max_test(2000);
+	return 0;
+}
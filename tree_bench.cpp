@@ -0,0 +1,138 @@
+#include <iostream>
+#include <vector>
+#include <cstdlib>
+#include <cassert>
+#include <cstdint>
+#include <unordered_map>
+
+#include "statistics.h"
+#include "link_cut_tree.h"
+#include "euler_tree.h"
+#include "bench_workload.h"
+
+using namespace std;
+
+// Adapters giving every forest the same index based interface.
+// Vertex i has key i, so answers can be compared across forests.
+
+struct Naive : NaiveForest {
+	Naive(const vector<size_t> &par) : NaiveForest(par) {}
+};
+
+template <bool Evertable>
+struct LCTForest {
+	typedef LinkCutTree<size_t, SumStatistic<size_t>, Evertable> LCT;
+	LCT lct;
+	vector<typename LCT::Node *> node;
+
+	LCTForest(const vector<size_t> &par) {
+		vector<size_t> keys(par.size());
+		for (size_t i = 0; i < par.size(); ++i) keys[i] = i;
+		node = lct.BuildFromParents(keys, par);
+	}
+
+	size_t FindRoot(size_t v) { return lct.FindRoot(node[v])->key; }
+	size_t Path(size_t v) { return lct.Path(node[v]).sum; }
+	size_t FindLCA(size_t v, size_t w) {
+		typename LCT::Node *l = lct.FindLCA(node[v], node[w]);
+		return l?l->key:NO_VERTEX;
+	}
+	void Relink(size_t v, size_t w) { lct.Cut(node[v]), lct.Link(node[v], node[w]); }
+	void Evert(size_t v) { lct.Evert(node[v]); }
+};
+
+// Edges are found by their end points, the child of an edge changes
+// with everts
+template <class ET>
+struct ETForest {
+	ET et;
+	vector<typename ET::Node *> node;
+	unordered_map<uint64_t, typename ET::Edge> edge;
+
+	static uint64_t Key(size_t v, size_t w) {
+		return v < w?(uint64_t(v) << 32 | w):(uint64_t(w) << 32 | v);
+	}
+
+	ETForest(const vector<size_t> &par) {
+		vector<size_t> keys(par.size());
+		vector<typename ET::Edge> edges;
+		for (size_t i = 0; i < par.size(); ++i) keys[i] = i;
+		node = et.BuildFromParents(keys, par, &edges);
+		for (size_t i = 0; i < par.size(); ++i)
+			if (par[i] != NO_VERTEX) edge[Key(i, par[i])] = edges[i];
+	}
+
+	size_t FindRoot(size_t v) { return et.FindRoot(node[v])->key; }
+	// Not in the Euler tour tree streams
+	size_t Path(size_t v) { assert(false); return 0; }
+	size_t FindLCA(size_t v, size_t w) {
+		typename ET::Node *l = et.FindLCA(node[v], node[w]);
+		return l?l->key:NO_VERTEX;
+	}
+	void Relink(size_t v, size_t w) {
+		size_t p = et.Parent(node[v])->key;
+		typename unordered_map<uint64_t, typename ET::Edge>::iterator it = edge.find(Key(v, p));
+		et.Cut(it->second);
+		edge.erase(it);
+		edge[Key(v, w)] = et.Link(node[v], node[w]);
+	}
+	void Evert(size_t v) { et.Evert(node[v]); }
+};
+
+template <class Forest>
+void run(const char *name, const vector<size_t> &par, const vector<Op> &stream, size_t expected) {
+	Forest forest(par);
+	size_t check = RunStream(name, forest, stream);
+	if (check != expected) cout << "  " << name << ": MISMATCH with the naive forest" << endl;
+}
+
+void bench_shape(Shape shape, size_t n, size_t ops) {
+	vector<size_t> par = MakeShape(shape, n);
+	cout << ShapeName(shape) << " tree, n = " << n << endl;
+
+	Op::Type lct_ops[] = { Op::FIND_ROOT, Op::PATH, Op::FIND_LCA, Op::RELINK };
+	vector<Op> stream = MakeStream(par, ops, vector<Op::Type>(lct_ops, lct_ops + 4));
+	Naive naive(par);
+	size_t expected = RunStream("naive parent array", naive, stream);
+	run<LCTForest<false> >("LinkCutTree", par, stream, expected);
+	run<LCTForest<true> >("LinkCutTree evertable", par, stream, expected);
+
+	Op::Type et_ops[] = { Op::FIND_ROOT, Op::FIND_LCA, Op::RELINK };
+	stream = MakeStream(par, ops, vector<Op::Type>(et_ops, et_ops + 3));
+	Naive et_naive(par);
+	expected = RunStream("naive parent array", et_naive, stream);
+	run<ETForest<EulerTree<size_t, false> > >("EulerTree", par, stream, expected);
+	run<ETForest<EulerTree<size_t, true> > >("EulerTree evertable", par, stream, expected);
+	run<ETForest<LCAEulerTree<size_t> > >("LCAEulerTree", par, stream, expected);
+}
+
+// Everts of random vertices, or of the two ends of a path in turn
+void bench_evert(Shape shape, size_t n, size_t ops, bool adversarial) {
+	vector<size_t> par = MakeShape(shape, n);
+	cout << ShapeName(shape) << " tree with " << (adversarial?"end to end":"random")
+		<< " everts, n = " << n << endl;
+
+	Op::Type lct_ops[] = { Op::FIND_ROOT, Op::PATH, Op::FIND_LCA, Op::EVERT };
+	vector<Op> stream = MakeStream(par, ops, vector<Op::Type>(lct_ops, lct_ops + 4), adversarial);
+	Naive naive(par);
+	size_t expected = RunStream("naive parent array", naive, stream);
+	run<LCTForest<true> >("LinkCutTree evertable", par, stream, expected);
+
+	Op::Type et_ops[] = { Op::FIND_ROOT, Op::FIND_LCA, Op::EVERT };
+	stream = MakeStream(par, ops, vector<Op::Type>(et_ops, et_ops + 3), adversarial);
+	Naive et_naive(par);
+	expected = RunStream("naive parent array", et_naive, stream);
+	run<ETForest<EulerTree<size_t, true> > >("EulerTree evertable", par, stream, expected);
+}
+
+int main(int argc, const char *argv[])
+{
+	size_t n = argc > 1?atol(argv[1]):20000;
+	size_t ops = argc > 2?atol(argv[2]):20000;
+	srand(1);
+	Shape shapes[] = { PATH, STAR, CATERPILLAR, RANDOM_TREE, BINARY };
+	for (size_t i = 0; i < 5; ++i) bench_shape(shapes[i], n, ops);
+	bench_evert(RANDOM_TREE, n, ops, false);
+	bench_evert(PATH, n, ops, true);
+	return 0;
+}